@@ -1,36 +1,120 @@
 #pragma once
 
 #include "../CachePolicy.h"
+#include "../CacheStatistics.h"
+#include "../CacheTtl.h"
+#include "../CacheSnapshot.h"
+#include "../NodePool.h"
 #include "ArcLruPart.h"
 #include "ArcLfuPart.h"
 
 #include <memory>
+#include <string>
 
 namespace Cache {
 
 template<typename Key, typename Value>
 class ArcCache : public CachePolicy<Key, Value> {
 public:
+    //节点池在这里统一持有：两个部分的main合计最多2*capacity个节点
+    //（自适应调整是一边加一边减，总量不变），外加LRU部分的一对虚拟
+    //头尾。池子共享后，升级进LFU部分就是把节点指针移交过去。
     explicit ArcCache(size_t capacity = 10, size_t transformThreshold = 2)
                     : capacity_(capacity)
                     , transformThreshold_(transformThreshold)
-                    , lruPart_(std::make_unique<ArcLruPart<Key, Value>>(capacity, transformThreshold))
-                    , lfuPart_(std::make_unique<ArcLfuPart<Key, Value>>(capacity, transformThreshold)) {}
+                    , nodePool_(capacity * 2 + 2)
+                    , lruPart_(std::make_unique<ArcLruPart<Key, Value>>(capacity, transformThreshold, nodePool_))
+                    , lfuPart_(std::make_unique<ArcLfuPart<Key, Value>>(capacity, transformThreshold, nodePool_)) {}
 
-    ~ArcCache() override = default;
+    //singleflight的写回线程先join，再拆两个部分和共享的节点池。
+    ~ArcCache() override { this->flight_.shutdown(); }
 
     void put(Key key, Value value) override;
     bool get(Key key, Value &value) override;
     Value get(Key key) override;
 
+    /**
+     * 异构查找版的get：Key是std::string而查找键还是请求缓冲区里的
+     * string_view切片时，探测和升级全程都直接用切片。只有未命中后
+     * 查ghost调整容量时才构造一次Key。
+     */
+    template<typename K2>
+    bool get(const K2 &key, Value &value) {
+        bool shouldTransform = false;
+        ExpireTime expireAt = noExpire();
+        if(lruPart_->get(key, value, shouldTransform, expireAt)) {
+            if(shouldTransform && lfuPart_->hasCapacity()) {
+                lfuPart_->adoptNode(lruPart_->detachNode(key));
+            }
+            stats_.recordHit();
+            return true;
+        }
+        if(lfuPart_->get(key, value)) {
+            stats_.recordHit();
+            return true;
+        }
+        checkGhostCaches(Key(key));
+        stats_.recordMiss();
+        return false;
+    }
+
+    //只探测两个部分的main，不动任何状态。
+    template<typename K2>
+    bool contains(const K2 &key) {
+        return lruPart_->contains(key) || lfuPart_->contains(key);
+    }
+
+    //带TTL的写入：条目在ttl之后过期，过期后get当作未命中，节点在
+    //被访问到时惰性回收（不进ghost，也不影响两部分的容量调整）。
+    void putWithTtl(Key key, Value value, std::chrono::milliseconds ttl);
+
+    //开启TinyLFU准入过滤。新key都经由LRU部分进入ARC，sketch建在
+    //那里；LFU部分只接收已经证明过自己的条目，不用过滤。
+    void enableAdmissionFilter() { lruPart_->enableAdmissionFilter(); }
+
+    //原地清空两个部分（节点全部回到共享的内存池），ghost也一并
+    //抹掉。两部分学到的容量划分保留：失效的是数据，不是访问模式。
+    void clear() override {
+        lruPart_->clear();
+        lfuPart_->clear();
+    }
+
+    //删除单个key，在哪个部分就从哪个部分摘（不进ghost）。
+    bool erase(Key key) override {
+        return lruPart_->erase(key) || lfuPart_->erase(key);
+    }
+
+    //读取/清零内置统计，淘汰计数从两个部分聚合过来。
+    CacheStatsSnapshot getStats() const {
+        CacheStatsSnapshot total = stats_.snapshot();
+        total += lruPart_->getStats();
+        total += lfuPart_->getStats();
+        return total;
+    }
+    void resetStats() { stats_.reset(); }
+
+    /**
+     * 快照持久化：每条记录带一个部分标记（0=LRU部分，1=LFU部分）和
+     * 访问计数，restore 把条目直接放回原来的部分、原来的频率，重启
+     * 后冷热分层和升级进度都在，不用重新观察。两部分的自适应容量
+     * 划分不持久化——那是对当时负载的响应，重启后从均分重新学起。
+     * TTL是进程本地的steady_clock，同样不持久化。
+     */
+    bool snapshot(const std::string &path);
+    bool restore(const std::string &path);
+
 private:
     bool checkGhostCaches(Key key);
 
 private:
     size_t capacity_;
     size_t transformThreshold_;
+    //两个部分共享的节点池，声明在部分之前，保证比它们活得久。
+    NodePool<ArcNode<Key, Value>> nodePool_;
     std::unique_ptr<ArcLruPart<Key, Value>> lruPart_;
     std::unique_ptr<ArcLfuPart<Key, Value>> lfuPart_;
+    //命中/未命中计数（淘汰记在两个部分里）
+    CacheStatistics stats_;
 };
 
 template<typename Key, typename Value>
@@ -47,37 +131,77 @@ bool ArcCache<Key, Value>::checkGhostCaches(Key key) {
         lfuPart_->increaseCapacity();
         inGhost = true;
     }
+    //ghost命中单独记一笔：这些未命中是容量不足造成的（条目刚被挤
+    //出去就又被要了），比例高说明该加缓存而不是怪负载。
+    if(inGhost) {
+        stats_.recordGhostHit();
+    }
     return inGhost;
 }
 
+/**
+ * 单遍写入：以前不管三七二十一先查两个ghost再调 lruPart_->put，
+ * put 内部还要再查一次 main，同一个key在哈希表里查了三遍。现在
+ * 先试着在 main 里原地更新（绝大多数重复写走这条最短路），都不在
+ * 才查ghost调整容量，最后以“确认不存在”的方式直接新建节点。
+ * 顺带修掉一个老问题：key在lfu部分时，老写法会往lru里再插一份，
+ * 两边value不一致。
+ */
 template<typename Key, typename Value>
 void ArcCache<Key, Value>::put(Key key, Value value) {
-    bool inGhost = checkGhostCaches(key);
-    if(inGhost) {
-        //不管在哪个ghost中，都是加入到LRU缓存中。
-        lruPart_->put(key, value);
-    }
-    else {
-        //如果不在ghost中，则根据key的hash值，加入到LRU缓存中。
-        lruPart_->put(key, value);
-    }
+    stats_.recordPut();
+    //已经在哪个部分里，就地更新，一次查找搞定。
+    if(lruPart_->updateIfExist(key, value)) return ;
+    if(lfuPart_->updateIfExist(key, value)) return ;
+
+    //真正的新key：查一次ghost调整两部分的容量，然后进LRU部分。
+    //value在这里才真正落位，前面的原地更新都是引用传递，所以
+    //调用方传右值时全程只有这一次move。
+    checkGhostCaches(key);
+    lruPart_->addNew(key, std::move(value));
 }
 
+//和put同样的单遍流程，只是节点带上过期时间。
 template<typename Key, typename Value>
-bool ArcCache<Key, Value>::get(Key key, Value &value) {
-    //调整容量
+void ArcCache<Key, Value>::putWithTtl(Key key, Value value, std::chrono::milliseconds ttl) {
+    stats_.recordPut();
+    ExpireTime expireAt = CacheClock::now() + ttl;
+    if(lruPart_->updateIfExist(key, value, expireAt)) return ;
+    if(lfuPart_->updateIfExist(key, value, expireAt)) return ;
+
     checkGhostCaches(key);
+    lruPart_->addNew(key, std::move(value), expireAt);
+}
+
+/**
+ * 单遍读取：命中在两个部分的main里就直接返回，不再像以前那样每次
+ * get都先把两个ghost查一遍——命中的key不可能同时在ghost里，那两次
+ * 查找在命中路径上是纯浪费。只有未命中时才查ghost调整容量。
+ */
+template<typename Key, typename Value>
+bool ArcCache<Key, Value>::get(Key key, Value &value) {
     bool shouldTransform = false;
-    if(lruPart_->get(key, value, shouldTransform)) {
-        //在lru中找到了
-        if(shouldTransform) {
-            //且访问次数超过了transformThreshold_，
-            //则也要放进lfu缓存中。
-            lfuPart_->put(key, value);
+    ExpireTime expireAt = noExpire();
+    if(lruPart_->get(key, value, shouldTransform, expireAt)) {
+        //在lru中找到了，且访问次数超过了transformThreshold_，把节点
+        //整个从lru部分摘下来移交给lfu部分：value、访问计数、TTL都
+        //跟着节点走，不拷贝value也不动节点池。以前是往lfu里再put一
+        //份拷贝、lru里的原件留着，同一个key占两个槽还会写出两个不
+        //一致的value。
+        if(shouldTransform && lfuPart_->hasCapacity()) {
+            lfuPart_->adoptNode(lruPart_->detachNode(key));
         }
+        stats_.recordHit();
         return true;
     }
-    return lfuPart_->get(key, value);
+    if(lfuPart_->get(key, value)) {
+        stats_.recordHit();
+        return true;
+    }
+    //未命中，查ghost调整容量，为接下来大概率发生的put做准备。
+    checkGhostCaches(key);
+    stats_.recordMiss();
+    return false;
 }
 
 template<typename Key, typename Value>
@@ -87,4 +211,61 @@ Value ArcCache<Key, Value>::get(Key key) {
     return value;
 }
 
+template<typename Key, typename Value>
+bool ArcCache<Key, Value>::snapshot(const std::string &path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if(!out) return false;
+    //条目数先占位，记录写完再回头补上。两个部分的锁挨个拿，写快照
+    //不用停全局的流量。
+    if(!snapshotWriteHeader(out, 0)) return false;
+
+    uint64_t count = 0;
+    bool ok = true;
+    auto writePart = [&](uint8_t part) {
+        return [&, part](const Key &key, const Value &value, size_t accessCount) {
+            if(!ok) return ;
+            uint32_t freq = static_cast<uint32_t>(accessCount);
+            ok = snapshotWrite(out, part) && snapshotWrite(out, freq)
+                 && snapshotWrite(out, key) && snapshotWrite(out, value);
+            if(ok) ++count;
+        };
+    };
+    lruPart_->forEachEntry(writePart(0));
+    lfuPart_->forEachEntry(writePart(1));
+    if(!ok) return false;
+    return snapshotPatchCount(out, count);
+}
+
+template<typename Key, typename Value>
+bool ArcCache<Key, Value>::restore(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if(!in) return false;
+    uint64_t count = 0;
+    if(!snapshotReadHeader(in, count)) return false;
+    for(uint64_t i = 0; i < count; ++i) {
+        uint8_t part = 0;
+        uint32_t freq = 0;
+        Key key{};
+        Value value{};
+        if(!snapshotRead(in, part) || !snapshotRead(in, freq)
+           || !snapshotRead(in, key) || !snapshotRead(in, value)) {
+            return false;
+        }
+        //两遍快照各拿各的锁，两遍之间被升级的key会带着两个不同的
+        //部分标记各出现一次。恢复时以先读到的记录为准：key已经在
+        //任一部分落位就跳过，不让同一个key同时住进两个部分（那样
+        //erase只会摘掉一份，另一份还会在后续的get里还魂）。
+        if(lruPart_->contains(key) || lfuPart_->contains(key)) {
+            continue;
+        }
+        if(part == 0) {
+            lruPart_->restoreEntry(std::move(key), std::move(value), freq);
+        }
+        else {
+            lfuPart_->restoreEntry(std::move(key), std::move(value), freq);
+        }
+    }
+    return true;
+}
+
 }// namespace Cache
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <memory>
+#include <utility>
+
+#include "../CacheTtl.h"
 
 namespace Cache {
 
@@ -10,28 +13,44 @@ public:
     template<typename K, typename V> friend class ArcLruPart;
     template<typename K, typename V> friend class ArcLfuPart;
 
-    ArcNode() : accessCount_(1), prev_(nullptr), next_(nullptr) {}
+    ArcNode() : accessCount_(1), prev_(nullptr), next_(nullptr)
+            , expireAt_(noExpire()) {}
 
     ArcNode(Key key, Value value)
-            : key_(key)
-            , value_(value)
+            : key_(std::move(key))
+            , value_(std::move(value))
             , accessCount_(1)
             , prev_(nullptr)
-            , next_(nullptr) {}
+            , next_(nullptr)
+            , expireAt_(noExpire()) {}
 
     Key getKey() const { return key_; }
-    Value getValue() const { return value_; }
+    //返回引用，由调用方决定拷还是不拷，省掉getter里的一次拷贝。
+    const Value &getValue() const { return value_; }
     size_t getAccessCount() const { return accessCount_; }
 
     void setValue(const Value &value) { value_ = value; }
+    //右值直接move进来，不拷贝。
+    void setValue(Value &&value) { value_ = std::move(value); }
     void incrementAccessCount() { ++accessCount_; }
+    //TTL相关。没设TTL的节点存noExpire()哨兵，先比对哨兵再取当前
+    //时间，不带TTL的访问路径上没有时钟开销。
+    ExpireTime getExpireAt() const { return expireAt_; }
+    void setExpireAt(ExpireTime expireAt) { expireAt_ = expireAt; }
+    bool isExpired() const {
+        return expireAt_ != noExpire() && CacheClock::now() >= expireAt_;
+    }
 
 private:
     Key key_;
     Value value_;
     size_t accessCount_;
-    std::shared_ptr<ArcNode> prev_;
-    std::shared_ptr<ArcNode> next_;
+    //侵入式双向链表的裸指针，节点的所有权在对应的缓存部分手里
+    //（节点池），链表操作不再有 shared_ptr 的原子引用计数开销。
+    ArcNode *prev_;
+    ArcNode *next_;
+    //过期时间，noExpire()表示永不过期。
+    ExpireTime expireAt_;
 };
 
 }//namespace Cache
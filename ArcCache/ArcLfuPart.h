@@ -6,6 +6,9 @@
 #include <list>
 
 #include "ArcCacheNode.h"
+#include "../NodePool.h"
+#include "../CacheStatistics.h"
+#include "../FlatHashMap.h"
 
 namespace Cache {
 
@@ -13,35 +16,157 @@ template<typename Key, typename Value>
 class ArcLfuPart {
 public:
     using NodeType = ArcNode<Key, Value>;
-    using NodePtr = std::shared_ptr<NodeType>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
+    using NodePtr = NodeType*;
+    //main 部分的索引用扁平哈希表：槽位连续、按容量一次建好，稳态
+    //下没有rehash。ghost 的索引不在命中路径上，保持 unordered_map。
+    using NodeMap = FlatHashMap<Key, NodePtr>;
     using FreqMap = std::map<size_t, std::list<NodePtr>>;
 
-    explicit ArcLfuPart(size_t capacity, size_t transformThreshold)
+    //节点池由 ArcCache 持有、两个部分共享：从LRU部分升级过来的
+    //节点整个移交，槽位不用先还再借。
+    explicit ArcLfuPart(size_t capacity, size_t transformThreshold,
+                        NodePool<NodeType> &nodePool)
                         : capacity_(capacity)
                         , ghostCapacity_(capacity)
                         , transformThreshold_(transformThreshold)
-                        , minFreq_(1) {
+                        , minFreq_(1)
+                        , nodePool_(nodePool)
+                        , mainCache_(capacity) {}
 
-        ghostHead_ = std::make_shared<NodeType>();
-        ghostTail_ = std::make_shared<NodeType>();
-        ghostHead_->next_ = ghostTail_;
-        ghostTail_->prev_ = ghostHead_;
+    //节点都是从池子里拿的裸指针，析构时逐个归还槽位。
+    ~ArcLfuPart() {
+        mainCache_.forEach([this](const Key &, NodePtr node) {
+            nodePool_.release(node);
+        });
     }
 
-    void put(Key key, Value value);
-    bool get(Key key, Value &value);
+    void put(Key key, Value value, ExpireTime expireAt = noExpire());
+    bool updateIfExist(const Key &key, Value &value, ExpireTime expireAt = noExpire());
+    //查找键对类型是模板的：string键可以直接拿string_view切片探测。
+    template<typename K2>
+    bool get(const K2 &key, Value &value);
+    //只探测不访问：不提升频率。过期的条目当作不在。
+    template<typename K2>
+    bool contains(const K2 &key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        NodePtr *found = mainCache_.find(key);
+        if(!found) return false;
+        if((*found)->isExpired()) {
+            eraseExpired(*found);
+            return false;
+        }
+        return true;
+    }
     bool checkGhost(Key key);
-    void increaseCapacity() { ++capacity_; }
+    //容量调整和ghost查询都走本部分的锁：它们和淘汰路径（往ghost里
+    //记key、按容量挑牺牲者）动的是同一批状态。
+    void increaseCapacity() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++capacity_;
+    }
     bool decreaseCapacity();
+    //本部分的淘汰计数，由 ArcCache 聚合。
+    CacheStatsSnapshot getStats() const { return stats_.snapshot(); }
+
+    //原地清空：main的节点归还内存池，频率链表和ghost一并抹掉。
+    //主动失效不记淘汰统计。
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        mainCache_.forEach([this](const Key &, NodePtr node) {
+            nodePool_.release(node);
+        });
+        mainCache_.clear();
+        freqMap_.clear();
+        minFreq_ = 1;
+        ghostList_.clear();
+        ghostCache_.clear();
+    }
+
+    //从main里删除单个key（不进ghost，不影响容量调整）。
+    bool erase(Key key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        NodePtr *found = mainCache_.find(key);
+        if(!found) return false;
+        NodePtr node = *found;
+        size_t freq = node->getAccessCount();
+        auto &freqList = freqMap_[freq];
+        freqList.remove(node);
+        if(freqList.empty()) {
+            freqMap_.erase(freq);
+            if(!freqMap_.empty()) {
+                minFreq_ = freqMap_.begin()->first;
+            }
+        }
+        mainCache_.erase(node->getKey());
+        nodePool_.release(node);
+        return true;
+    }
+
+    //容量被自适应调成0时不接收节点，调用方让节点留在LRU部分
+    //（和以前put在0容量下是空操作的语义一致）。capacity_会被别的
+    //线程的容量调整并发改动，读也要在锁下。
+    bool hasCapacity() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return capacity_ > 0;
+    }
+
+    /**
+     * 接收从LRU部分移交过来的节点（detachNode 的另一半）：节点按
+     * 自己攒下的访问计数直接落进对应频率的链表，value、TTL原样保留。
+     * key已经在本部分的罕见情况（老快照恢复出的重复）就地更新后把
+     * 多余的节点还给池子。
+     */
+    void adoptNode(NodePtr node) {
+        if(!node) return ;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        NodePtr *found = mainCache_.find(node->getKey());
+        if(found) {
+            (*found)->setValue(std::move(node->value_));
+            (*found)->setExpireAt(node->getExpireAt());
+            updateNodePosition(*found);
+            nodePool_.release(node);
+            return ;
+        }
+        if(mainCache_.size() >= capacity_) {
+            removeMainToGhost();
+        }
+        mainCache_[node->getKey()] = node;
+        freqMap_[node->getAccessCount()].push_back(node);
+        minFreq_ = freqMap_.begin()->first;
+    }
+
+    //快照用：按频率从小到大遍历main里没过期的条目（锁内）。
+    template<typename Fn>
+    void forEachEntry(Fn fn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(auto &entry : freqMap_) {
+            for(NodePtr node : entry.second) {
+                if(node->isExpired()) continue;
+                fn(node->getKey(), node->getValue(), node->getAccessCount());
+            }
+        }
+    }
+
+    //恢复单条快照记录：节点直接落进对应频率的链表，不用从1重新攒。
+    void restoreEntry(Key key, Value value, size_t accessCount) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(capacity_ == 0) return ;
+        if(mainCache_.size() >= capacity_) {
+            removeMainToGhost();
+        }
+        NodePtr node = nodePool_.acquire(key, std::move(value));
+        node->accessCount_ = accessCount < 1 ? 1 : accessCount;
+        mainCache_[key] = node;
+        freqMap_[node->getAccessCount()].push_back(node);
+        minFreq_ = freqMap_.begin()->first;
+    }
 
 private:
-    void addNewNode(const Key &key, const Value &value);
-    //ghost中的节点从尾部插入，淘汰头部的节点
-    void removeGhostNode(NodePtr node);
+    void addNewNode(const Key &key, Value value, ExpireTime expireAt);
     void removeMainToGhost();
-    void insertNodeToGhost(NodePtr node);
     void updateNodePosition(NodePtr node);
+    void eraseExpired(NodePtr node);
 
 private:
     size_t capacity_;
@@ -50,30 +175,23 @@ private:
     //用于标记频率最小的链表节点，删除时直接定位
     //到该链表中删除。
     size_t minFreq_;
-    std::mutex mutex_;
+    //mutable：hasCapacity这样的const查询也要在锁下读自适应容量。
+    mutable std::mutex mutex_;
+    //两个部分共享的节点内存池（ArcCache 持有），main 部分的节点
+    //槽位从这里拿。
+    NodePool<NodeType> &nodePool_;
 
     NodeMap mainCache_;
     FreqMap freqMap_;
 
-    NodeMap ghostCache_;
-    NodePtr ghostHead_;
-    NodePtr ghostTail_;
+    //Ghost cache：只记 key（FIFO，尾部插入、头部淘汰），不存 value
+    //和链表节点，被淘汰节点的 value 在离开 main 的那一刻就释放了。
+    std::list<Key> ghostList_;
+    std::unordered_map<Key, typename std::list<Key>::iterator> ghostCache_;
+    //淘汰计数
+    CacheStatistics stats_;
 };
 
-template<typename Key, typename Value>
-void ArcLfuPart<Key, Value>::insertNodeToGhost(NodePtr node) {
-    node->next_ = ghostTail_;
-    node->prev_ = ghostTail_->prev_;
-    ghostTail_->prev_->next_ = node;
-    ghostTail_->prev_ = node;
-}
-
-template<typename Key, typename Value>
-void ArcLfuPart<Key, Value>::removeGhostNode(NodePtr node) {
-    node->prev_->next_ = node->next_;
-    node->next_->prev_ = node->prev_;
-}
-
 template<typename Key, typename Value>
 void ArcLfuPart<Key, Value>::removeMainToGhost() {
     if(freqMap_.empty()) return ;
@@ -94,27 +212,50 @@ void ArcLfuPart<Key, Value>::removeMainToGhost() {
         }
     }
 
-    //将移除的节点添加到ghost中。
+    //value 不用跟着进ghost，节点在这里就归还给节点池。
+    Key key = node->getKey();
+    nodePool_.release(node);
+    stats_.recordEviction();
+
+    //将被淘汰的key记到ghost中。
     if(ghostCache_.size() >= ghostCapacity_) {
-        //如果ghost满了，则删除最久没有访问的节点，
-        //是按照先进先出的规则，这里采用尾部插入，
-        //头部删除的方法。
-        if(ghostHead_->next_ == ghostTail_) return ;
-        ghostCache_.erase(ghostHead_->next_->getKey());
-        removeGhostNode(ghostHead_->next_);
-    }
-    insertNodeToGhost(node);
-    ghostCache_[node->getKey()] = node;
+        //如果ghost满了，则按照先进先出的规则淘汰最老的key，
+        //这里采用尾部插入，头部删除的方法。
+        if(ghostList_.empty()) return ;
+        ghostCache_.erase(ghostList_.front());
+        ghostList_.pop_front();
+    }
+    ghostList_.push_back(key);
+    ghostCache_[key] = std::prev(ghostList_.end());
+}
+
+//把一个已经过期的节点从main里整个摘掉。过期不是容量压力，key不进
+//ghost，不影响两部分的容量调整。
+template<typename Key, typename Value>
+void ArcLfuPart<Key, Value>::eraseExpired(NodePtr node) {
+    size_t freq = node->getAccessCount();
+    auto &freqList = freqMap_[freq];
+    freqList.remove(node);
+    if(freqList.empty()) {
+        freqMap_.erase(freq);
+        if(!freqMap_.empty()) {
+            minFreq_ = freqMap_.begin()->first;
+        }
+    }
+    mainCache_.erase(node->getKey());
+    nodePool_.release(node);
+    stats_.recordEviction();
 }
 
 //注意：新来的节点放尾部，旧的节点越靠近头部，所以淘汰时是删除头部的节点
 template<typename Key, typename Value>
-void ArcLfuPart<Key, Value>::addNewNode(const Key &key, const Value &value) {
+void ArcLfuPart<Key, Value>::addNewNode(const Key &key, Value value, ExpireTime expireAt) {
     if(mainCache_.size() >= capacity_) {
         removeMainToGhost(); 
     }
-    //创建新节点。
-    NodePtr newNode = std::make_shared<NodeType>(key, value);
+    //从节点池中取槽位创建新节点。
+    NodePtr newNode = nodePool_.acquire(key, std::move(value));
+    newNode->setExpireAt(expireAt);
     mainCache_[key] = newNode;
     //将新节点添加到频率为1的链表中
     if(freqMap_.find(1) == freqMap_.end()) {
@@ -150,30 +291,60 @@ void ArcLfuPart<Key, Value>::updateNodePosition(NodePtr node) {
 }
 
 template<typename Key, typename Value>
-void ArcLfuPart<Key, Value>::put(Key key, Value value) {
-    if(capacity_ == 0) return ;
-
+void ArcLfuPart<Key, Value>::put(Key key, Value value, ExpireTime expireAt) {
+    //capacity_会被并发的容量调整改动，判空也要在锁下。
     std::lock_guard<std::mutex> lock(mutex_);
-    auto it = mainCache_.find(key);
-    if(it != mainCache_.end()) {
+    if(capacity_ == 0) return ;
+    NodePtr *found = mainCache_.find(key);
+    if(found) {
         //原来已经有了，就不用创建新的，直接更改value和更新位置即可。
-        it->second->setValue(value);
+        (*found)->setValue(value);
+        (*found)->setExpireAt(expireAt);
         //更新节点位置
-        updateNodePosition(it->second);
+        updateNodePosition(*found);
         return ;
     }
     //不存在，则创建新节点添加进去。
-    addNewNode(key, value);
+    addNewNode(key, std::move(value), expireAt);
 }
 
+//key已存在时更新value和频率位置并返回true，不存在时什么都不做。
+//给 ArcCache 的单遍 put 流程用。value按引用传入，只在真的命中时
+//才move进节点；返回false时原封不动留给调用方。
 template<typename Key, typename Value>
-bool ArcLfuPart<Key, Value>::get(Key key, Value &value) {
+bool ArcLfuPart<Key, Value>::updateIfExist(const Key &key, Value &value, ExpireTime expireAt) {
     std::lock_guard<std::mutex> lock(mutex_);
-    auto it = mainCache_.find(key);
-    if(it != mainCache_.end()) {
-        value = it->second->getValue();
+    NodePtr *found = mainCache_.find(key);
+    if(!found) return false;
+    NodePtr node = *found;
+    if(node->isExpired()) {
+        //过期的节点等于不存在，回收掉让调用方按新key插入。
+        eraseExpired(node);
+        return false;
+    }
+
+    node->setValue(std::move(value));
+    //重新put会刷新过期时间（包括从有TTL改成没TTL）。
+    node->setExpireAt(expireAt);
+    updateNodePosition(node);
+    return true;
+}
+
+template<typename Key, typename Value>
+template<typename K2>
+bool ArcLfuPart<Key, Value>::get(const K2 &key, Value &value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    NodePtr *found = mainCache_.find(key);
+    if(found) {
+        NodePtr node = *found;
+        if(node->isExpired()) {
+            //过期的条目不算命中，顺手把它回收掉。
+            eraseExpired(node);
+            return false;
+        }
+        value = node->getValue();
         //更新节点位置
-        updateNodePosition(it->second);
+        updateNodePosition(node);
         return true;
     }
     return false;
@@ -181,10 +352,12 @@ bool ArcLfuPart<Key, Value>::get(Key key, Value &value) {
 
 template<typename Key, typename Value>
 bool ArcLfuPart<Key, Value>::checkGhost(Key key) {
+    std::lock_guard<std::mutex> lock(mutex_);
     auto it = ghostCache_.find(key);
     if(it != ghostCache_.end()) {
-        //在ghost中，则从ghost中移除，添加到LRU中。
-        removeGhostNode(it->second);
+        //在ghost中记过这个key，把记录抹掉。命中ghost说明这个key马上
+        //会被重新put进缓存。
+        ghostList_.erase(it->second);
         ghostCache_.erase(it);
         return true;
     }
@@ -193,6 +366,7 @@ bool ArcLfuPart<Key, Value>::checkGhost(Key key) {
 
 template<typename Key, typename Value>
 bool ArcLfuPart<Key, Value>::decreaseCapacity() {
+    std::lock_guard<std::mutex> lock(mutex_);
     if(capacity_ == 0) return false;
 
     if(mainCache_.size() == capacity_) {
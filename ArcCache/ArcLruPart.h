@@ -2,8 +2,15 @@
 
 #include <unordered_map>
 #include <mutex>
+#include <list>
 
 #include "ArcCacheNode.h"
+#include "../NodePool.h"
+#include "../CacheStatistics.h"
+#include "../FrequencySketch.h"
+#include "../FlatHashMap.h"
+
+#include <memory>
 
 namespace Cache {
 
@@ -11,53 +18,171 @@ template<typename Key, typename Value>
 class ArcLruPart {
 public:
     using NodeType = ArcNode<Key, Value>;
-    using NodePtr = std::shared_ptr<NodeType>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
+    using NodePtr = NodeType*;
+    //main 部分的索引用扁平哈希表：槽位连续、按容量一次建好，稳态
+    //下没有rehash。ghost 的索引不在命中路径上，保持 unordered_map。
+    using NodeMap = FlatHashMap<Key, NodePtr>;
 
-    explicit ArcLruPart(size_t capacity, size_t transformThreshold)
+    //节点池由 ArcCache 持有、两个部分共享：升级进LFU部分时节点
+    //整个移交过去，槽位不用先还再借。
+    explicit ArcLruPart(size_t capacity, size_t transformThreshold,
+                        NodePool<NodeType> &nodePool)
                         : capacity_(capacity)
                         , ghostCapacity_(capacity)
-                        , transformThreshold_(transformThreshold) {
+                        , transformThreshold_(transformThreshold)
+                        , nodePool_(nodePool)
+                        , mainCache_(capacity) {
 
-        mainHead_ = std::make_shared<NodeType>();
-        mainTail_ = std::make_shared<NodeType>();
+        mainHead_ = nodePool_.acquire();
+        mainTail_ = nodePool_.acquire();
         mainHead_->next_ = mainTail_;
         mainTail_->prev_ = mainHead_;
+    }
 
-        ghostHead_ = std::make_shared<NodeType>();
-        ghostTail_ = std::make_shared<NodeType>();
-        ghostHead_->next_ = ghostTail_;
-        ghostTail_->prev_ = ghostHead_;
+    //节点都是从池子里拿的裸指针，析构时逐个归还槽位。
+    ~ArcLruPart() {
+        mainCache_.forEach([this](const Key &, NodePtr node) {
+            nodePool_.release(node);
+        });
+        nodePool_.release(mainHead_);
+        nodePool_.release(mainTail_);
     }
 
     void put(Key key, Value value);
-    bool get(Key key, Value &value, bool &shouldTransform);
+    bool updateIfExist(const Key &key, Value &value, ExpireTime expireAt = noExpire());
+    void addNew(Key key, Value value, ExpireTime expireAt = noExpire());
+    //查找键对类型是模板的：string键可以直接拿string_view切片探测。
+    template<typename K2>
+    bool get(const K2 &key, Value &value, bool &shouldTransform, ExpireTime &expireAt);
+    //只探测不访问：不挪位置、不记频率。过期的条目当作不在。
+    template<typename K2>
+    bool contains(const K2 &key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        NodePtr *found = mainCache_.find(key);
+        if(!found) return false;
+        if((*found)->isExpired()) {
+            eraseExpired(*found);
+            return false;
+        }
+        return true;
+    }
     bool checkGhost(Key key);
-    void increaseCapacity() { ++capacity_; }
+    //容量调整和ghost查询都走本部分的锁：它们和淘汰路径（往ghost里
+    //记key、按容量挑牺牲者）动的是同一批状态。
+    void increaseCapacity() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++capacity_;
+    }
     bool decreaseCapacity();
+    //本部分的淘汰计数，由 ArcCache 聚合。
+    CacheStatsSnapshot getStats() const { return stats_.snapshot(); }
+
+    //原地清空：main的节点归还内存池，ghost的记录一并抹掉。主动
+    //失效不记淘汰统计。
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        mainCache_.forEach([this](const Key &, NodePtr node) {
+            nodePool_.release(node);
+        });
+        mainCache_.clear();
+        mainHead_->next_ = mainTail_;
+        mainTail_->prev_ = mainHead_;
+        ghostList_.clear();
+        ghostCache_.clear();
+    }
+
+    //从main里删除单个key（不进ghost，不影响容量调整）。
+    bool erase(Key key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        NodePtr *found = mainCache_.find(key);
+        if(!found) return false;
+        NodePtr node = *found;
+        mainCache_.erase(node->getKey());
+        removeNode(node);
+        nodePool_.release(node);
+        return true;
+    }
+
+    /**
+     * 把一个节点从main里整个摘下来交给调用方（升级进LFU部分用）。
+     * 节点不归还池子、key不进ghost——这不是淘汰，value和访问计数、
+     * TTL都原样跟着节点走，省掉一次value拷贝和一对release/acquire。
+     */
+    template<typename K2>
+    NodePtr detachNode(const K2 &key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        NodePtr *found = mainCache_.find(key);
+        if(!found) return nullptr;
+        NodePtr node = *found;
+        removeNode(node);
+        mainCache_.erase(node->getKey());
+        node->prev_ = nullptr;
+        node->next_ = nullptr;
+        return node;
+    }
+
+    //开启TinyLFU准入过滤。新key都从这个部分进入ARC，所以sketch
+    //放在这里：满了之后新key要和即将进ghost的牺牲者比估计频率，
+    //比不过就不准入，扫描型负载顶不掉常驻条目。
+    void enableAdmissionFilter() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sketch_.reset(new FrequencySketch<Key>(capacity_));
+    }
+
+    //快照用：按从冷到热的顺序遍历main里没过期的条目（锁内）。
+    template<typename Fn>
+    void forEachEntry(Fn fn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(NodePtr node = mainHead_->next_; node != mainTail_; node = node->next_) {
+            if(node->isExpired()) continue;
+            fn(node->getKey(), node->getValue(), node->getAccessCount());
+        }
+    }
+
+    //恢复单条快照记录：key确定是新的，直接落位，访问计数也还原，
+    //离升级门槛攒了几次就还是几次。
+    void restoreEntry(Key key, Value value, size_t accessCount) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(capacity_ == 0) return ;
+        addNewNode(key, std::move(value), noExpire());
+        NodePtr *found = mainCache_.find(key);
+        if(found) (*found)->accessCount_ = accessCount;
+    }
 
 private:
     void removeNode(NodePtr node);
     void insertNode(NodePtr node);
-    void insertNodeToGhost(NodePtr node);
-    void addNewNode(const Key &key, const Value &value);
+    void addNewNode(const Key &key, Value value, ExpireTime expireAt);
     void removeMainToGhost(NodePtr node);
+    void eraseExpired(NodePtr node);
 
 private:
     size_t capacity_;
     size_t ghostCapacity_;
     size_t transformThreshold_;
     std::mutex mutex_;
+    //两个部分共享的节点内存池（ArcCache 持有），main 部分的节点
+    //槽位从这里拿。
+    NodePool<NodeType> &nodePool_;
 
     // Main cache
     NodeMap mainCache_;
     NodePtr mainHead_;
     NodePtr mainTail_;
 
-    // Ghost cache
-    NodeMap ghostCache_;
-    NodePtr ghostHead_;
-    NodePtr ghostTail_;
+    /**
+     * Ghost cache：只记 key，不存 value 和链表节点。ghost 的作用只是
+     * 回答“这个key最近被淘汰过没有”来调整两部分的容量，存整个节点
+     * 等于让被淘汰的 value 继续占着内存。这里用一条 FIFO 的 key 链表
+     * 加一个 key 到链表位置的哈希表，每个 ghost 条目只占一个 key 的
+     * 大小，淘汰节点的 value 在离开 main 的那一刻就释放了。
+     */
+    std::list<Key> ghostList_;
+    std::unordered_map<Key, typename std::list<Key>::iterator> ghostCache_;
+    //淘汰计数
+    CacheStatistics stats_;
+    //TinyLFU准入过滤的频率sketch，空表示不开准入。
+    std::unique_ptr<FrequencySketch<Key>> sketch_;
 };
 
 template<typename Key, typename Value>
@@ -68,14 +193,6 @@ void ArcLruPart<Key, Value>::insertNode(NodePtr node) {
     mainTail_->prev_ = node;
 }
 
-template<typename Key, typename Value>
-void ArcLruPart<Key, Value>::insertNodeToGhost(NodePtr node) {
-    node->next_ = ghostTail_;
-    node->prev_ = ghostTail_->prev_;
-    ghostTail_->prev_->next_ = node;
-    ghostTail_->prev_ = node;
-}
-
 template<typename Key, typename Value>
 void ArcLruPart<Key, Value>::removeNode(NodePtr node) {
     node->prev_->next_ = node->next_;
@@ -89,61 +206,130 @@ void ArcLruPart<Key, Value>::removeMainToGhost(NodePtr node) {
 
     //移除最久未使用的节点。即头节点后面的节点。
     removeNode(node);
-    mainCache_.erase(node->getKey());
+    Key key = node->getKey();
+    mainCache_.erase(key);
+    //value 不用跟着进ghost，节点在这里就归还给节点池。
+    nodePool_.release(node);
+    stats_.recordEviction();
 
-    //将移除的节点添加到ghost中。
+    //将被淘汰的key记到ghost中。
     if(ghostCache_.size() >= ghostCapacity_) {
-        //如果ghost中也满了，则按照先进先出的方式淘汰节点。
-        if(ghostHead_->next_ == ghostTail_) return ;
-        ghostCache_.erase(ghostHead_->next_->getKey());
-        removeNode(ghostHead_->next_);
-    }
-    //添加到ghost中。
-    insertNodeToGhost(node);
-    ghostCache_[node->getKey()] = node;
+        //如果ghost中也满了，则按照先进先出的方式淘汰最老的key。
+        if(ghostList_.empty()) return ;
+        ghostCache_.erase(ghostList_.front());
+        ghostList_.pop_front();
+    }
+    ghostList_.push_back(key);
+    ghostCache_[key] = std::prev(ghostList_.end());
 }
 
+//把一个已经过期的节点从main里整个摘掉。过期不是容量压力，key不进
+//ghost，不影响两部分的容量调整。
 template<typename Key, typename Value>
-void ArcLruPart<Key, Value>::addNewNode(const Key &key, const Value &value) {
+void ArcLruPart<Key, Value>::eraseExpired(NodePtr node) {
+    mainCache_.erase(node->getKey());
+    removeNode(node);
+    nodePool_.release(node);
+    stats_.recordEviction();
+}
+
+template<typename Key, typename Value>
+void ArcLruPart<Key, Value>::addNewNode(const Key &key, Value value, ExpireTime expireAt) {
     if(mainCache_.size() >= capacity_) {
+        if(sketch_) {
+            //准入过滤：比不过牺牲者的新key不进缓存，也不动ghost。
+            NodePtr victim = mainHead_->next_;
+            if(victim != mainTail_ &&
+               sketch_->estimate(key) <= sketch_->estimate(victim->getKey())) {
+                return ;
+            }
+        }
         removeMainToGhost(mainHead_->next_);
     }
-    NodePtr newNode = std::make_shared<NodeType>(key, value);
+    NodePtr newNode = nodePool_.acquire(key, std::move(value));
+    newNode->setExpireAt(expireAt);
     mainCache_[key] = newNode;
     insertNode(newNode);
 }
 
 template<typename Key, typename Value>
 void ArcLruPart<Key, Value>::put(Key key, Value value) {
-    if(capacity_ == 0) return ;
-
+    //capacity_会被并发的容量调整改动，判空也要在锁下。
     std::lock_guard<std::mutex> lock(mutex_);
-    auto it = mainCache_.find(key);
-    if(it != mainCache_.end()) {
-        it->second->setValue(value);
+    if(capacity_ == 0) return ;
+    NodePtr *found = mainCache_.find(key);
+    if(found) {
+        NodePtr node = *found;
+        node->setValue(value);
         //原来就已经存在，则不需要增加新节点，只需更新它的值
         //和更换位置即可。
         //移除原来的节点。
-        removeNode(it->second);
+        removeNode(node);
         //插入到最近访问的位置，这里最近访问的位置在表尾，所以使用
         //尾插法。
-        insertNode(it->second);
+        insertNode(node);
         return ;
     }
     //如果不存在这个节点，则创建它，并添加进去。
-    addNewNode(key, value);
+    addNewNode(key, std::move(value), noExpire());
+}
+
+//key已存在时更新value和位置并返回true，不存在时什么都不做。
+//给 ArcCache 的单遍 put 流程用：先试着原地更新，失败了才走
+//ghost 判断和新建节点，避免同一个key查两遍表。value按引用传入，
+//只在真的命中时才move进节点；返回false时原封不动留给调用方去
+//新建节点，两个部分各探测一遍也不产生拷贝。
+template<typename Key, typename Value>
+bool ArcLruPart<Key, Value>::updateIfExist(const Key &key, Value &value, ExpireTime expireAt) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(sketch_) sketch_->recordAccess(key);
+    NodePtr *found = mainCache_.find(key);
+    if(!found) return false;
+    NodePtr node = *found;
+    if(node->isExpired()) {
+        //过期的节点等于不存在，回收掉让调用方按新key插入。
+        eraseExpired(node);
+        return false;
+    }
+
+    node->setValue(std::move(value));
+    //重新put会刷新过期时间（包括从有TTL改成没TTL）。
+    node->setExpireAt(expireAt);
+    removeNode(node);
+    insertNode(node);
+    return true;
 }
 
+//调用方已经确认key不在main中，直接新建节点，省掉一次查找。
 template<typename Key, typename Value>
-bool ArcLruPart<Key, Value>::get(Key key, Value &value, bool &shouldTransform) {
+void ArcLruPart<Key, Value>::addNew(Key key, Value value, ExpireTime expireAt) {
     std::lock_guard<std::mutex> lock(mutex_);
-    auto it = mainCache_.find(key);
-    if(it != mainCache_.end()) {
-        value = it->second->getValue();
-        it->second->incrementAccessCount();
-        removeNode(it->second);
-        insertNode(it->second);
-        if(it->second->getAccessCount() >= transformThreshold_) {
+    if(capacity_ == 0) return ;
+    if(sketch_) sketch_->recordAccess(key);
+    addNewNode(key, std::move(value), expireAt);
+}
+
+//expireAt 把命中节点的过期时间带出去，升级进LFU部分时TTL要跟着走。
+template<typename Key, typename Value>
+template<typename K2>
+bool ArcLruPart<Key, Value>::get(const K2 &key, Value &value, bool &shouldTransform, ExpireTime &expireAt) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    //未命中的访问也要记，新key的频率就是靠这些未命中攒起来的。
+    if(sketch_) sketch_->recordAccess(key);
+    NodePtr *found = mainCache_.find(key);
+    if(found) {
+        NodePtr node = *found;
+        if(node->isExpired()) {
+            //过期的条目不算命中，顺手把它回收掉。
+            eraseExpired(node);
+            return false;
+        }
+        value = node->getValue();
+        expireAt = node->getExpireAt();
+        node->incrementAccessCount();
+        removeNode(node);
+        insertNode(node);
+        if(node->getAccessCount() >= transformThreshold_) {
             shouldTransform = true;
         }
         return true;
@@ -153,11 +339,12 @@ bool ArcLruPart<Key, Value>::get(Key key, Value &value, bool &shouldTransform) {
 
 template<typename Key, typename Value>
 bool ArcLruPart<Key, Value>::checkGhost(Key key) {
+    std::lock_guard<std::mutex> lock(mutex_);
     auto it = ghostCache_.find(key);
     if(it != ghostCache_.end()) {
-        //如果存在这个节点，则将它从ghostCache_中移除，并添加到mainCache_中。
-        //注意：在ghost中找到了，就要将它从ghost中移除，然后再添加到main中。
-        removeNode(it->second);
+        //在ghost中记过这个key，把记录抹掉。命中ghost说明这个key马上
+        //会被重新put进main。
+        ghostList_.erase(it->second);
         ghostCache_.erase(it);
         return true;
     }
@@ -166,6 +353,7 @@ bool ArcLruPart<Key, Value>::checkGhost(Key key) {
 
 template<typename Key, typename Value>
 bool ArcLruPart<Key, Value>::decreaseCapacity() {
+    std::lock_guard<std::mutex> lock(mutex_);
     if(capacity_ <= 0) return false;
 
     if(mainCache_.size() == capacity_) {
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Cache {
+
+//构造分片缓存时选NUMA交错模式用的标签（类似std::in_place的用法）。
+struct NumaInterleaved {};
+
+//把当前线程绑到指定CPU上。只在Linux上生效，其它平台是空操作
+//（构造照常完成，只是拿不到放置上的好处）。
+inline void bindCurrentThreadToCpu(unsigned cpu) {
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+#else
+    (void)cpu;
+#endif
+}
+
+/**
+ * 分片的NUMA友好构造：Linux默认的NUMA策略是first-touch——一页内存
+ * 落在第一个写它的线程所在的节点上。分片缓存的内存大头（节点池的
+ * arena、扁平索引的槽位数组）都在构造时整块分配并写过一遍，所以
+ * 谁构造、内存就归谁的节点。全部分片在同一个线程上构造时，多路
+ * 机器上约一半的命中要跨节点取内存。
+ *
+ * 这里把每个分片的构造丢到各自的线程上跑，线程按下标均匀绑到
+ * [0, 核数) 区间的CPU上——CPU编号在多路机器上按节点分段，均匀
+ * 铺开就等于把分片交错落在各个节点上。之后分片内的节点都从自己
+ * 的arena复用，一次命中摸到的索引槽位、链表节点、value全在同
+ * 一个节点的内存里。
+ */
+template<typename Fn>
+inline void constructShardsInterleaved(size_t shardCount, Fn constructOne) {
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> builders;
+    builders.reserve(shardCount);
+    for(size_t i = 0; i < shardCount; ++i) {
+        builders.emplace_back([&constructOne, i, cpus, shardCount] {
+            bindCurrentThreadToCpu(static_cast<unsigned>(i * cpus / shardCount) % cpus);
+            constructOne(i);
+        });
+    }
+    for(auto &builder : builders) {
+        builder.join();
+    }
+}
+
+}// namespace Cache
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <vector>
+#include <utility>
+#include <future>
+
+#include "SingleFlight.h"
+
 namespace Cache {
 
 template <typename Key, typename Value>
@@ -25,6 +31,80 @@ public:
     virtual bool get(Key key, Value &value) = 0;
 
     virtual Value get(Key key) = 0;
+
+    /**
+     * 主动失效接口。配置纪元切换这类流程以前靠销毁重建整个缓存实例
+     * 来清场，几百万个节点的析构加上重新预分配就是一场分配风暴；
+     * clear 原地清空并回收节点存储（内存池和索引的槽位数组原样保留
+     * 复用），erase 删除单个key。两者都是调用方主动的失效，不算
+     * 淘汰：不走淘汰回调，也不记进淘汰统计。
+     */
+    virtual void clear() = 0;
+    virtual bool erase(Key key) = 0;
+
+    /**
+     * 批量接口：一次请求往往要查几十个key，逐个调用 get/put 每次都要
+     * 抢一把锁。这里提供默认的逐个实现保证所有子类可用，具体缓存会
+     * 重写成整批只加一次锁（分片缓存则按分片分组，每个分片加一次锁）。
+     */
+    virtual void putMany(const std::vector<std::pair<Key, Value>> &items) {
+        for(const auto &item : items) {
+            put(item.first, item.second);
+        }
+    }
+
+    //values 和 found 会被调整为和 keys 一样长，found[i] 表示 keys[i]
+    //是否命中，返回值是命中总数。
+    virtual size_t getMany(const std::vector<Key> &keys,
+                           std::vector<Value> &values,
+                           std::vector<bool> &found) {
+        values.assign(keys.size(), Value{});
+        found.assign(keys.size(), false);
+        size_t hitCount = 0;
+        for(size_t i = 0; i < keys.size(); ++i) {
+            if(get(keys[i], values[i])) {
+                found[i] = true;
+                ++hitCount;
+            }
+        }
+        return hitCount;
+    }
+
+    using Loader = typename SingleFlight<Key, Value>::Loader;
+
+    /**
+     * 读穿透：命中直接返回，未命中时通过singleflight回源——同一个
+     * key的并发加载合并成一次loader执行，结果只put一次，其余调用方
+     * 等同一份结果，热点key的未命中风暴不会打穿后端。默认实现用
+     * 本实例自己的在途表，分片缓存会重写成转发给对应分片，让在途
+     * 表也按分片拆开。
+     */
+    virtual Value getOrLoad(Key key, const Loader &loader) {
+        Value value{};
+        if(get(key, value)) {
+            return value;
+        }
+        return flight_.load(key, loader,
+                [this](const Key &k, Value v) { put(k, std::move(v)); });
+    }
+
+    //异步版：返回future，调用方不停在这儿等。命中时返回就绪的
+    //future；未命中时loader在独立线程上跑，同key的并发调用拿到
+    //同一个future。
+    virtual std::shared_future<Value> getOrLoadAsync(Key key, const Loader &loader) {
+        Value value{};
+        if(get(key, value)) {
+            std::promise<Value> ready;
+            ready.set_value(std::move(value));
+            return ready.get_future().share();
+        }
+        return flight_.loadAsync(key, loader,
+                [this](const Key &k, Value v) { put(k, std::move(v)); });
+    }
+
+protected:
+    //每个缓存实例自己的在途航班表。
+    SingleFlight<Key, Value> flight_;
 };
 
 } // namespace Cache
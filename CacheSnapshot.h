@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <type_traits>
+
+namespace Cache {
+
+/**
+ * 快照持久化的公共底层：紧凑二进制格式的字段读写。
+ *
+ * 每次发版重启进程都要从零填缓存，回填的十来分钟里未命中全打到
+ * 后端。把缓存内容连同新旧/频率元数据写成快照，重启后整批加载，
+ * 实例几秒内就回到重启前的命中率。
+ *
+ * 文件格式：魔数 + 条目数的头，后面跟各个缓存自己定义的定长/变长
+ * 记录。读写都是头到尾的顺序IO，操作系统的预读会把加载的IO重叠掉，
+ * 这里不用mmap——顺序整批读流式就够快，还不用管页对齐和平台差异。
+ *
+ * 平凡可拷贝的类型直接按内存位写；std::string 写长度加字节串。别的
+ * 类型要自己提供 snapshotWrite/snapshotRead 的重载。快照文件默认
+ * 同机同构使用（字节序、类型布局都按本机算），不是跨平台交换格式。
+ */
+
+//快照文件开头的魔数（"CCS1"），读取时先校验，免得把别的文件当快照。
+constexpr uint32_t kSnapshotMagic = 0x31534343;
+
+template<typename T>
+inline bool snapshotWrite(std::ostream &out, const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "为非平凡类型提供snapshotWrite重载");
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    return static_cast<bool>(out);
+}
+
+inline bool snapshotWrite(std::ostream &out, const std::string &value) {
+    uint64_t len = value.size();
+    out.write(reinterpret_cast<const char *>(&len), sizeof(len));
+    out.write(value.data(), static_cast<std::streamsize>(len));
+    return static_cast<bool>(out);
+}
+
+template<typename T>
+inline bool snapshotRead(std::istream &in, T &value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "为非平凡类型提供snapshotRead重载");
+    in.read(reinterpret_cast<char *>(&value), sizeof(T));
+    return static_cast<bool>(in);
+}
+
+inline bool snapshotRead(std::istream &in, std::string &value) {
+    uint64_t len = 0;
+    if(!in.read(reinterpret_cast<char *>(&len), sizeof(len))) return false;
+    value.resize(len);
+    if(len > 0) {
+        in.read(&value[0], static_cast<std::streamsize>(len));
+    }
+    return static_cast<bool>(in);
+}
+
+//条目数在写记录时往往还不知道（过期的条目会被跳过），先写占位，
+//全部记录落盘后由调用方seek回来补。
+inline bool snapshotWriteHeader(std::ostream &out, uint64_t count) {
+    return snapshotWrite(out, kSnapshotMagic) && snapshotWrite(out, count);
+}
+
+inline bool snapshotReadHeader(std::istream &in, uint64_t &count) {
+    uint32_t magic = 0;
+    return snapshotRead(in, magic) && magic == kSnapshotMagic
+           && snapshotRead(in, count);
+}
+
+//写完所有记录后回头补上真实的条目数。
+inline bool snapshotPatchCount(std::ostream &out, uint64_t count) {
+    out.seekp(sizeof(kSnapshotMagic));
+    if(!snapshotWrite(out, count)) return false;
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+}// namespace Cache
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Cache {
+
+//统计数据的普通快照，从 CacheStatistics 里读出来之后随便拷贝、相加。
+struct CacheStatsSnapshot {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t puts = 0;
+    uint64_t evictions = 0;
+    //未命中但key还在ghost名单上（ARC专用）：说明条目是被容量挤出
+    //去的而不是真的没人要，这个数字高意味着缓存整体偏小。
+    uint64_t ghostHits = 0;
+
+    double hitRate() const {
+        uint64_t total = hits + misses;
+        return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+    }
+
+    //聚合多个分片/部分的统计用。
+    CacheStatsSnapshot &operator+=(const CacheStatsSnapshot &other) {
+        hits += other.hits;
+        misses += other.misses;
+        puts += other.puts;
+        evictions += other.evictions;
+        ghostHits += other.ghostHits;
+        return *this;
+    }
+};
+
+/**
+ * 缓存命中/未命中/淘汰的内置计数器。计数用 relaxed 的原子自增，
+ * 热路径上就是一条普通的带锁前缀加法，不引入任何同步点；读取方
+ * 通过 snapshot() 拿一份一致性要求不高的普通快照。
+ */
+class CacheStatistics {
+public:
+    void recordHit() { hits_.fetch_add(1, std::memory_order_relaxed); }
+    void recordMiss() { misses_.fetch_add(1, std::memory_order_relaxed); }
+    void recordPut() { puts_.fetch_add(1, std::memory_order_relaxed); }
+    void recordEviction() { evictions_.fetch_add(1, std::memory_order_relaxed); }
+    void recordGhostHit() { ghostHits_.fetch_add(1, std::memory_order_relaxed); }
+
+    CacheStatsSnapshot snapshot() const {
+        CacheStatsSnapshot s;
+        s.hits = hits_.load(std::memory_order_relaxed);
+        s.misses = misses_.load(std::memory_order_relaxed);
+        s.puts = puts_.load(std::memory_order_relaxed);
+        s.evictions = evictions_.load(std::memory_order_relaxed);
+        s.ghostHits = ghostHits_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    void reset() {
+        hits_.store(0, std::memory_order_relaxed);
+        misses_.store(0, std::memory_order_relaxed);
+        puts_.store(0, std::memory_order_relaxed);
+        evictions_.store(0, std::memory_order_relaxed);
+        ghostHits_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> puts_{0};
+    std::atomic<uint64_t> evictions_{0};
+    std::atomic<uint64_t> ghostHits_{0};
+};
+
+} // namespace Cache
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <chrono>
+
+namespace Cache {
+
+//TTL统一用steady_clock计时，不受系统时间回拨的影响。
+using CacheClock = std::chrono::steady_clock;
+using ExpireTime = CacheClock::time_point;
+
+//“永不过期”的哨兵值。没设TTL的节点都存这个值，过期判断先比对
+//哨兵，没设TTL的访问路径不用取当前时间。
+inline ExpireTime noExpire() { return ExpireTime::max(); }
+
+}// namespace Cache
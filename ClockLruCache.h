@@ -0,0 +1,188 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "CachePolicy.h"
+#include "CacheStatistics.h"
+#include "FlatHashMap.h"
+
+namespace Cache {
+
+/**
+ * CLOCK（二次机会）近似LRU，面向读多写少的并发场景。
+ *
+ * 互斥锁版本的LRU每次命中都要改链表指针：既要拿独占锁串行化，又把
+ * 链表节点的缓存行写脏，读线程一多，瓶颈全在锁和缓存行弹跳上，哈希
+ * 表本身反而不是问题。CLOCK把“最近用过”的信息压成每个槽位一个引用
+ * 位：命中只是共享锁下的一次哈希探测加一个 relaxed 的原子置位，不改
+ * 任何共享结构，读线程之间完全并行；只有写入/淘汰才拿独占锁，由表针
+ * 扫过槽位，引用位为1的清零放过（二次机会），为0的淘汰。
+ *
+ * 淘汰顺序是LRU的近似：引用位只记“这一圈内用过没用过”，不记次序，
+ * 换来的是命中路径零锁争用。热点负载下命中率和真LRU基本持平，可用
+ * benchmark 对比验证。
+ */
+template<typename Key, typename Value>
+class ClockLruCache : public CachePolicy<Key, Value> {
+    //一个缓存槽位。槽位数组在构造时定死，之后只被复用，不增不减。
+    struct Slot {
+        Key key{};
+        Value value{};
+        //引用位：命中时置1，表针扫过时清零。
+        std::atomic<uint8_t> referenced{0};
+    };
+
+public:
+    explicit ClockLruCache(size_t capacity)
+            : capacity_(capacity)
+            , usedSlots_(0)
+            , hand_(0)
+            , slots_(capacity)
+            , indexMap_(capacity) {}
+
+    //singleflight的写回线程先join，再拆缓存自己的状态。
+    ~ClockLruCache() override { this->flight_.shutdown(); }
+
+    void put(Key key, Value value) override;
+    bool get(Key key, Value &value) override;
+    Value get(Key key) override {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    //读取/清零内置统计。
+    CacheStatsSnapshot getStats() const { return stats_.snapshot(); }
+    void resetStats() { stats_.reset(); }
+
+    //原地清空：槽位数组原地重置复用（置默认值释放key/value自己的
+    //资源），索引槽位数组同样保留，没有堆释放和分配。
+    void clear() override {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        for(size_t i = 0; i < usedSlots_; ++i) {
+            slots_[i].key = Key{};
+            slots_[i].value = Value{};
+            slots_[i].referenced.store(0, std::memory_order_relaxed);
+        }
+        indexMap_.clear();
+        usedSlots_ = 0;
+        hand_ = 0;
+    }
+
+    //删除单个key：把最后一个在用的槽位挪过来补洞，空槽始终集中在
+    //尾部，装满之前的按序取空槽逻辑不受影响。
+    bool erase(Key key) override {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        size_t *found = indexMap_.find(key);
+        if(!found) return false;
+        size_t idx = *found;
+        indexMap_.erase(key);
+        size_t lastIdx = usedSlots_ - 1;
+        if(idx != lastIdx) {
+            slots_[idx].key = std::move(slots_[lastIdx].key);
+            slots_[idx].value = std::move(slots_[lastIdx].value);
+            slots_[idx].referenced.store(
+                slots_[lastIdx].referenced.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+            indexMap_[slots_[idx].key] = idx;
+        }
+        slots_[lastIdx].key = Key{};
+        slots_[lastIdx].value = Value{};
+        slots_[lastIdx].referenced.store(0, std::memory_order_relaxed);
+        --usedSlots_;
+        //表针不能停在空槽区里。
+        if(hand_ >= usedSlots_) hand_ = 0;
+        return true;
+    }
+
+private:
+    //表针找下一个牺牲槽位：引用位为1的清零放过，为0的选中。
+    //所有引用位都为1时第一圈全部清零，第二圈必然选中，最多走两圈。
+    size_t findVictimSlot();
+
+private:
+    size_t capacity_;
+    //已经用掉的槽位数，装满之前新条目直接按序取空槽，不走表针。
+    size_t usedSlots_;
+    //表针位置
+    size_t hand_;
+    std::vector<Slot> slots_;
+    //key到槽位下标的索引（扁平哈希表，按容量一次建好，稳态下不rehash）
+    FlatHashMap<Key, size_t> indexMap_;
+    //读写锁：命中路径共享，写入/淘汰独占。
+    mutable std::shared_mutex mutex_;
+    //命中/未命中/淘汰计数
+    CacheStatistics stats_;
+};
+
+template<typename Key, typename Value>
+size_t ClockLruCache<Key, Value>::findVictimSlot() {
+    while(true) {
+        Slot &slot = slots_[hand_];
+        size_t idx = hand_;
+        hand_ = (hand_ + 1) % capacity_;
+        //exchange顺便把引用位清零：为1说明这一圈内被用过，给它
+        //二次机会；为0就是牺牲者。
+        if(slot.referenced.exchange(0, std::memory_order_relaxed) == 0) {
+            return idx;
+        }
+    }
+}
+
+template<typename Key, typename Value>
+void ClockLruCache<Key, Value>::put(Key key, Value value) {
+    if(capacity_ == 0) return ;
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    stats_.recordPut();
+    size_t *found = indexMap_.find(key);
+    if(found) {
+        //已经存在，原地更新value并置引用位。
+        Slot &slot = slots_[*found];
+        slot.value = std::move(value);
+        slot.referenced.store(1, std::memory_order_relaxed);
+        return ;
+    }
+
+    size_t idx;
+    if(usedSlots_ < capacity_) {
+        //还有空槽，按序取一个。
+        idx = usedSlots_++;
+    }
+    else {
+        //装满了，表针选一个牺牲槽位复用。
+        idx = findVictimSlot();
+        indexMap_.erase(slots_[idx].key);
+        stats_.recordEviction();
+    }
+    Slot &slot = slots_[idx];
+    slot.key = key;
+    slot.value = std::move(value);
+    //新条目引用位从0开始：表针刚走过这个槽位，它有整整一圈的时间
+    //证明自己被用到。写入就置1的话，冷key的连番写入会把所有引用位
+    //打满，表针被迫整圈清零后退化成FIFO，反而会扫掉真正的热点。
+    slot.referenced.store(0, std::memory_order_relaxed);
+    indexMap_[key] = idx;
+}
+
+template<typename Key, typename Value>
+bool ClockLruCache<Key, Value>::get(Key key, Value &value) {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    size_t *found = indexMap_.find(key);
+    if(!found) {
+        stats_.recordMiss();
+        return false;
+    }
+    Slot &slot = slots_[*found];
+    value = slot.value;
+    //整个命中路径对共享数据只有这一个 relaxed 写，不改链表、不挪
+    //节点，读线程之间互不弄脏对方的缓存行（除了引用位本身）。
+    slot.referenced.store(1, std::memory_order_relaxed);
+    stats_.recordHit();
+    return true;
+}
+
+}// namespace Cache
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Cache {
+
+/**
+ * 透明哈希：按查找键自己的类型做std::hash，不要求先转成表的Key。
+ * std::hash 保证 string 和 string_view 对相同内容给出相同的值，
+ * 所以 string 键的表可以直接拿 string_view 切片来探测，不用为一次
+ * 查找在堆上物化一个 std::string。
+ */
+struct TransparentHash {
+    template<typename K>
+    size_t operator()(const K &key) const {
+        return std::hash<K>{}(key);
+    }
+    //字符串字面量按内容哈希，免得退化成指针哈希。
+    size_t operator()(const char *key) const {
+        return std::hash<std::string_view>{}(std::string_view(key));
+    }
+};
+
+/**
+ * 开放寻址的扁平哈希表，专给各个缓存策略做key到节点指针的索引。
+ *
+ * std::unordered_map 每个桶是单独分配的链表节点：一次探测要先追桶
+ * 数组的指针，再追桶节点的指针，条目一多就是两三次彼此依赖的缓存
+ * 未命中。这里key和value内联存在一个连续的槽位数组里，线性探测，
+ * 大多数查找只碰一两条相邻的缓存行。
+ *
+ * 用robin-hood插入（富者让位：探测距离短的条目给距离长的让位）压住
+ * 探测长度的方差，删除用后移（backward shift）补洞，不留墓碑——
+ * 缓存的淘汰就是高频删除，墓碑会越积越多拖垮探测。
+ *
+ * 构造时按预期条目数一次建好（负载系数不超过2/3），缓存的容量是
+ * 固定的，稳态下永远不会rehash；万一超了也能翻倍重建兜底。
+ *
+ * find 可以传入算好的hash，分片缓存在外层已经算过一次hash时，内层
+ * 探测不必再算第二次。
+ */
+template<typename Key, typename T, typename Hash = TransparentHash>
+class FlatHashMap {
+    //一个槽位：key和value内联。dist_单独放一个数组，探测时只扫
+    //dist_，不命中的槽位连key都不用碰。
+    struct Slot {
+        Key key{};
+        T value{};
+    };
+    //空槽位的探测距离标记。
+    static constexpr int16_t kEmpty = -1;
+
+public:
+    explicit FlatHashMap(size_t expectedEntries) {
+        //负载系数不超过2/3：容量预留1.5倍再取2的幂。
+        size_t want = expectedEntries + expectedEntries / 2 + 8;
+        cap_ = roundUpPow2(want);
+        mask_ = cap_ - 1;
+        slots_.resize(cap_);
+        dist_.assign(cap_, kEmpty);
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    //找到返回value的指针，没找到返回nullptr。查找键不必是Key本身：
+    //任何能和Key比较相等、std::hash对相同内容给相同值的类型（比如
+    //string 键配 string_view 切片）都可以直接探测。
+    template<typename K2>
+    T *find(const K2 &key) { return find(key, hasher_(key)); }
+
+    //hash已经在外面算过时用这个重载，省掉第二次哈希计算。
+    template<typename K2>
+    T *find(const K2 &key, size_t hash) {
+        size_t idx = spread(hash) & mask_;
+        int16_t d = 0;
+        while(true) {
+            //比我们当前距离还短的槽位（包括空槽）意味着key不存在：
+            //robin-hood不变式保证它如果存在早就该在这之前出现。
+            if(dist_[idx] < d) return nullptr;
+            if(slots_[idx].key == key) return &slots_[idx].value;
+            idx = (idx + 1) & mask_;
+            ++d;
+        }
+    }
+
+    //取value的引用，key不存在就插入一个默认值（用法和
+    //unordered_map 的 operator[] 一致）。
+    T &operator[](const Key &key) { return findOrInsert(key, hasher_(key)); }
+
+    //插入版的“hash在外面已经算过”重载，和 find(key, hash) 配对：
+    //分片缓存选分片时算过一次hash，写路径也不用再算第二次。
+    T &findOrInsert(const Key &key, size_t hash) {
+        //稳态下不会走到：容量在构造时就按上限建好了。
+        if(size_ + 1 > cap_ - cap_ / 3) grow();
+
+        size_t idx = spread(hash) & mask_;
+        int16_t d = 0;
+        //带着待插入的条目往前走，碰到更“富”的（距离更短的）就换出来
+        //继续帮它找位置。
+        Key k = key;
+        T v{};
+        T *result = nullptr;
+        while(true) {
+            if(dist_[idx] == kEmpty) {
+                slots_[idx].key = std::move(k);
+                slots_[idx].value = std::move(v);
+                dist_[idx] = d;
+                ++size_;
+                return result ? *result : slots_[idx].value;
+            }
+            //还没安家之前碰到相同的key，直接返回已有条目。
+            if(result == nullptr && slots_[idx].key == k) {
+                return slots_[idx].value;
+            }
+            if(dist_[idx] < d) {
+                std::swap(k, slots_[idx].key);
+                std::swap(v, slots_[idx].value);
+                std::swap(d, dist_[idx]);
+                if(result == nullptr) {
+                    result = &slots_[idx].value;
+                }
+            }
+            idx = (idx + 1) & mask_;
+            ++d;
+        }
+    }
+
+    //删除一个key，后面的条目往前挪补洞（不留墓碑）。
+    bool erase(const Key &key) {
+        size_t idx = spread(hasher_(key)) & mask_;
+        int16_t d = 0;
+        while(true) {
+            if(dist_[idx] < d) return false;
+            if(slots_[idx].key == key) break;
+            idx = (idx + 1) & mask_;
+            ++d;
+        }
+
+        size_t next = (idx + 1) & mask_;
+        while(dist_[next] > 0) {
+            slots_[idx] = std::move(slots_[next]);
+            dist_[idx] = dist_[next] - 1;
+            idx = next;
+            next = (next + 1) & mask_;
+        }
+        slots_[idx] = Slot{};
+        dist_[idx] = kEmpty;
+        --size_;
+        return true;
+    }
+
+    //一把清空：槽位数组原地保留复用，占着的槽位重置成默认值释放
+    //key/value自己的资源，不发生任何堆分配或释放。
+    void clear() {
+        for(size_t i = 0; i < cap_; ++i) {
+            if(dist_[i] != kEmpty) {
+                slots_[i] = Slot{};
+                dist_[i] = kEmpty;
+            }
+        }
+        size_ = 0;
+    }
+
+    //遍历所有条目（析构释放节点、聚合统计用）。
+    template<typename Fn>
+    void forEach(Fn fn) {
+        for(size_t i = 0; i < cap_; ++i) {
+            if(dist_[i] != kEmpty) {
+                fn(slots_[i].key, slots_[i].value);
+            }
+        }
+    }
+
+    //按槽位下标访问，给增量扫描（LFU老化）做可中断的游标用。
+    //稳态下不rehash，条目顶多因为邻居的插入删除在槽位间小范围挪动。
+    size_t slotCount() const { return cap_; }
+    bool occupiedAt(size_t idx) const { return dist_[idx] != kEmpty; }
+    T &valueAt(size_t idx) { return slots_[idx].value; }
+
+private:
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 1;
+        while(p < n) p <<= 1;
+        return p;
+    }
+
+    //把std::hash的结果再搅一遍：整数key的std::hash是恒等映射，
+    //直接取低位当下标会让相邻key挤在一起。
+    static size_t spread(size_t h) {
+        uint64_t x = h;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return static_cast<size_t>(x);
+    }
+
+    //兜底的翻倍重建，稳态下不会触发。
+    void grow() {
+        std::vector<Slot> oldSlots = std::move(slots_);
+        std::vector<int16_t> oldDist = std::move(dist_);
+        size_t oldCap = cap_;
+
+        cap_ *= 2;
+        mask_ = cap_ - 1;
+        slots_.clear();
+        slots_.resize(cap_);
+        dist_.assign(cap_, kEmpty);
+        size_ = 0;
+        for(size_t i = 0; i < oldCap; ++i) {
+            if(oldDist[i] != kEmpty) {
+                (*this)[oldSlots[i].key] = std::move(oldSlots[i].value);
+            }
+        }
+    }
+
+private:
+    size_t cap_;
+    size_t mask_;
+    size_t size_;
+    std::vector<Slot> slots_;
+    //每个槽位的robin-hood探测距离，kEmpty表示空槽。
+    std::vector<int16_t> dist_;
+    Hash hasher_;
+};
+
+}// namespace Cache
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "CachePolicy.h"
+#include "CacheStatistics.h"
+#include "FlatHashMap.h"
+#include "LruCache.h"
+
+namespace Cache {
+
+//内联布局接纳的value上限：一个缓存行的大小。再大的value内联进
+//槽位数组反而会把相邻条目挤出缓存行，得不偿失。
+inline constexpr size_t kInlineValueLimit = 64;
+
+/**
+ * 面向小value的内联布局LRU。
+ *
+ * 通用的 LruCache 为了撑起TTL、淘汰回调、字节预算这些能力，每个
+ * 条目是内存池里的一个独立节点，链表用指针串：一次命中要从索引跳
+ * 到节点再摸两个邻居，三四个分散的缓存行；64位指针一对就是16字节，
+ * 对16字节的value来说纯链接开销就翻了一倍。
+ *
+ * 这里把条目直接铺在一个按容量定死的扁平槽位数组里：value内联在
+ * 槽位中，LRU链用32位的槽位下标代替指针（容量不会超过2^32-1）。
+ * 一次命中就是索引里一次探测加一次下标拼接，摸到的全部数据——
+ * key、value、两个4字节链接——挤在一两个缓存行里；每条目的链接
+ * 开销从16字节降到8字节，再省掉节点各自分配的对齐填料。
+ *
+ * 代价是value必须是平凡可拷贝的小类型（淘汰就是改几个下标，没有
+ * 析构要跑，槽位直接覆写复用），并且不提供TTL/回调/字节预算——
+ * 要这些能力或value不满足约束时用通用的 LruCache，编译期选型可以
+ * 直接用下面的 SmallValueLruCache 别名。
+ */
+template<typename Key, typename Value>
+class FlatLruCache : public CachePolicy<Key, Value> {
+    static_assert(std::is_trivially_copyable<Value>::value,
+                  "FlatLruCache 只接纳平凡可拷贝的value，其它类型请用 LruCache");
+    static_assert(sizeof(Value) <= kInlineValueLimit,
+                  "value超过一个缓存行，内联进槽位数组得不偿失，请用 LruCache");
+
+    //空链接/空表头的哨兵值。
+    static constexpr uint32_t kNull = 0xFFFFFFFFu;
+
+    //一个内联槽位：value和链接都在条目本体里，没有第二跳。
+    struct Slot {
+        Key key{};
+        Value value{};
+        uint32_t prev{kNull};
+        uint32_t next{kNull};
+    };
+
+public:
+    explicit FlatLruCache(size_t capacity)
+            : capacity_(capacity)
+            , usedSlots_(0)
+            , slots_(capacity)
+            , indexMap_(capacity) {}
+
+    //singleflight的写回线程先join，再拆缓存自己的状态。
+    ~FlatLruCache() override { this->flight_.shutdown(); }
+
+    void put(Key key, Value value) override;
+    bool get(Key key, Value &value) override;
+    Value get(Key key) override {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    //异构查找版的get/contains：探测直接用原始的key切片，不物化Key。
+    template<typename K2>
+    bool get(const K2 &key, Value &value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t *found = indexMap_.find(key);
+        if(!found) {
+            stats_.recordMiss();
+            return false;
+        }
+        value = slots_[*found].value;
+        moveToBack(*found);
+        stats_.recordHit();
+        return true;
+    }
+
+    template<typename K2>
+    bool contains(const K2 &key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return indexMap_.find(key) != nullptr;
+    }
+
+    //原地清空：槽位数组置默认值复用（释放key自己的资源，value是
+    //平凡类型没有要释放的），索引槽位数组保留，没有堆释放和分配。
+    void clear() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(size_t i = 0; i < usedSlots_; ++i) {
+            slots_[i] = Slot{};
+        }
+        indexMap_.clear();
+        usedSlots_ = 0;
+        head_ = kNull;
+        tail_ = kNull;
+        freeHead_ = kNull;
+    }
+
+    //删除单个key：从LRU链上摘下，槽位挂到空闲链上等复用。链接是
+    //稳定的下标，不像CLOCK那样搬尾槽补洞。
+    bool erase(Key key) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t *found = indexMap_.find(key);
+        if(!found) return false;
+        uint32_t idx = *found;
+        unlink(idx);
+        indexMap_.erase(key);
+        slots_[idx] = Slot{};
+        //复用next当空闲链的链接。
+        slots_[idx].next = freeHead_;
+        freeHead_ = idx;
+        return true;
+    }
+
+    //读取/清零内置统计。
+    CacheStatsSnapshot getStats() const { return stats_.snapshot(); }
+    void resetStats() { stats_.reset(); }
+
+private:
+    //从LRU链上摘下一个槽位（表头是最久未用端，表尾是最近使用端）。
+    void unlink(uint32_t idx) {
+        Slot &slot = slots_[idx];
+        if(slot.prev != kNull) slots_[slot.prev].next = slot.next;
+        else head_ = slot.next;
+        if(slot.next != kNull) slots_[slot.next].prev = slot.prev;
+        else tail_ = slot.prev;
+        slot.prev = kNull;
+        slot.next = kNull;
+    }
+
+    //挂到表尾（最近使用端）。
+    void linkBack(uint32_t idx) {
+        Slot &slot = slots_[idx];
+        slot.prev = tail_;
+        slot.next = kNull;
+        if(tail_ != kNull) slots_[tail_].next = idx;
+        else head_ = idx;
+        tail_ = idx;
+    }
+
+    void moveToBack(uint32_t idx) {
+        if(tail_ == idx) return ;
+        unlink(idx);
+        linkBack(idx);
+    }
+
+    //拿一个可写的槽位：优先空闲链，其次未用过的顺序槽，都没有就
+    //淘汰表头（最久未用）复用它的槽位。
+    uint32_t grabSlot() {
+        if(freeHead_ != kNull) {
+            uint32_t idx = freeHead_;
+            freeHead_ = slots_[idx].next;
+            slots_[idx].next = kNull;
+            return idx;
+        }
+        if(usedSlots_ < capacity_) {
+            return static_cast<uint32_t>(usedSlots_++);
+        }
+        uint32_t victim = head_;
+        unlink(victim);
+        indexMap_.erase(slots_[victim].key);
+        stats_.recordEviction();
+        return victim;
+    }
+
+private:
+    size_t capacity_;
+    //已经用过的顺序槽位数，装满之前新条目按序取空槽。
+    size_t usedSlots_;
+    //LRU链的头（最久未用）和尾（最近使用），kNull表示空链。
+    uint32_t head_{kNull};
+    uint32_t tail_{kNull};
+    //被erase腾出的空闲槽位链，用槽位的next串起来。
+    uint32_t freeHead_{kNull};
+    std::mutex mutex_;
+    //内联槽位数组，构造时按容量定死，之后只复用。
+    std::vector<Slot> slots_;
+    //key到槽位下标的索引（扁平哈希表，按容量一次建好，稳态下不rehash）
+    FlatHashMap<Key, uint32_t> indexMap_;
+    //命中/未命中/淘汰计数
+    CacheStatistics stats_;
+};
+
+template<typename Key, typename Value>
+void FlatLruCache<Key, Value>::put(Key key, Value value) {
+    if(capacity_ == 0) return ;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.recordPut();
+    uint32_t *found = indexMap_.find(key);
+    if(found) {
+        //已经存在，原地覆写value并挪到最近使用端。
+        slots_[*found].value = value;
+        moveToBack(*found);
+        return ;
+    }
+
+    uint32_t idx = grabSlot();
+    Slot &slot = slots_[idx];
+    slot.key = std::move(key);
+    slot.value = value;
+    linkBack(idx);
+    indexMap_[slot.key] = idx;
+}
+
+template<typename Key, typename Value>
+bool FlatLruCache<Key, Value>::get(Key key, Value &value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t *found = indexMap_.find(key);
+    if(!found) {
+        stats_.recordMiss();
+        return false;
+    }
+    value = slots_[*found].value;
+    moveToBack(*found);
+    stats_.recordHit();
+    return true;
+}
+
+//编译期选型：value是小的平凡可拷贝类型时值得走内联布局。
+template<typename Value>
+inline constexpr bool isInlineCacheValue =
+    std::is_trivially_copyable<Value>::value && sizeof(Value) <= kInlineValueLimit;
+
+//按value的类型自动选引擎：满足内联条件用 FlatLruCache，否则退回
+//功能齐全的 LruCache。小value的部署换个别名就拿到紧凑布局，代码
+//其余部分不用动。
+template<typename Key, typename Value>
+using SmallValueLruCache = std::conditional_t<
+    isInlineCacheValue<Value>, FlatLruCache<Key, Value>, LruCache<Key, Value>>;
+
+}// namespace Cache
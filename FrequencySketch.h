@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace Cache {
+
+/**
+ * TinyLFU用的频率估计器：count-min sketch 加 doorkeeper。
+ *
+ * 准入过滤需要知道“这个key最近被访问得频不频繁”，但又不能为此再养
+ * 一个完整的历史缓存（LruKCache 的 historyList_ 就是一个带锁的
+ * LruCache，每个key一个节点加哈希表项，太重）。这里每个key只占几个
+ * bit：4行count-min计数器（4bit饱和，打包在uint64_t里，一个字放16
+ * 个）记频率的近似值，查询取4行的最小值，被别的key碰撞只会高估不会
+ * 低估；doorkeeper是一层位图，第一次见到的key只点个bit不进计数器，
+ * 把海量只出现一次的扫描key挡在sketch外面，计数器空间留给真正的
+ * 回头客。
+ *
+ * 计数到达采样上限后整体减半（衰减），让旧热点的频率随时间让位给
+ * 新热点，doorkeeper同时清空。
+ */
+template<typename Key>
+class FrequencySketch {
+public:
+    explicit FrequencySketch(size_t capacity)
+            : additions_(0) {
+        //每个uint64_t装16个4bit计数器，表大小取2的幂方便掩码。
+        size_t words = roundUpPow2(capacity < 64 ? 4 : capacity / 16);
+        table_.assign(words, 0);
+        tableMask_ = words - 1;
+        //doorkeeper位图：表字数*64个bit。
+        doorkeeper_.assign(words, 0);
+        doorBitMask_ = words * 64 - 1;
+        //采样上限取容量的10倍，到达后计数整体减半。
+        sampleSize_ = capacity < 16 ? 160 : capacity * 10;
+    }
+
+    //记一次访问。第一次见到的key只进doorkeeper，再次见到才进计数器。
+    //key可以是能和Key互换哈希的异构类型（string键配string_view）。
+    template<typename K2 = Key>
+    void recordAccess(const K2 &key) {
+        uint64_t hash = spread(std::hash<K2>{}(key));
+        if(!doorkeeperTest(hash)) {
+            doorkeeperSet(hash);
+        }
+        else {
+            for(int row = 0; row < 4; ++row) {
+                incrementAt(hash, row);
+            }
+        }
+        if(++additions_ >= sampleSize_) {
+            reset();
+        }
+    }
+
+    //估计访问频率：4行计数器的最小值，doorkeeper里有记录再加1。
+    template<typename K2 = Key>
+    int estimate(const K2 &key) const {
+        uint64_t hash = spread(std::hash<K2>{}(key));
+        int freq = 15;
+        for(int row = 0; row < 4; ++row) {
+            int c = counterAt(hash, row);
+            if(c < freq) freq = c;
+        }
+        return freq + (doorkeeperTest(hash) ? 1 : 0);
+    }
+
+private:
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 1;
+        while(p < n) p <<= 1;
+        return p;
+    }
+
+    //把std::hash的结果再搅一遍：整数key的std::hash是恒等映射，
+    //低位直接当下标会撞成一团。
+    static uint64_t spread(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    //第row行的计数器位置：每行用不同的种子再混一次hash，
+    //高位选表中的字，低4位选字内的计数器。
+    void locate(uint64_t hash, int row, size_t &word, int &shift) const {
+        static const uint64_t seeds[4] = {
+            0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL,
+            0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL,
+        };
+        uint64_t h = (hash ^ seeds[row]) * seeds[row];
+        h += h >> 32;
+        word = static_cast<size_t>(h >> 8) & tableMask_;
+        shift = static_cast<int>(h & 15) * 4;
+    }
+
+    int counterAt(uint64_t hash, int row) const {
+        size_t word;
+        int shift;
+        locate(hash, row, word, shift);
+        return static_cast<int>((table_[word] >> shift) & 0xf);
+    }
+
+    //4bit饱和自增，到15就不再加。
+    void incrementAt(uint64_t hash, int row) {
+        size_t word;
+        int shift;
+        locate(hash, row, word, shift);
+        if(((table_[word] >> shift) & 0xf) != 0xf) {
+            table_[word] += (1ULL << shift);
+        }
+    }
+
+    bool doorkeeperTest(uint64_t hash) const {
+        size_t bit = static_cast<size_t>(hash) & doorBitMask_;
+        return (doorkeeper_[bit >> 6] >> (bit & 63)) & 1;
+    }
+
+    void doorkeeperSet(uint64_t hash) {
+        size_t bit = static_cast<size_t>(hash) & doorBitMask_;
+        doorkeeper_[bit >> 6] |= (1ULL << (bit & 63));
+    }
+
+    //衰减：所有计数器右移一位（每个4bit域单独减半），doorkeeper
+    //清空，让旧热点随时间退场。
+    void reset() {
+        for(auto &word : table_) {
+            word = (word >> 1) & 0x7777777777777777ULL;
+        }
+        for(auto &word : doorkeeper_) {
+            word = 0;
+        }
+        additions_ /= 2;
+    }
+
+private:
+    //count-min计数器表，每个字16个4bit计数器。
+    std::vector<uint64_t> table_;
+    size_t tableMask_;
+    //doorkeeper位图
+    std::vector<uint64_t> doorkeeper_;
+    size_t doorBitMask_;
+    //距离下次衰减的计数
+    size_t additions_;
+    size_t sampleSize_;
+};
+
+}// namespace Cache
@@ -6,60 +6,408 @@
 #include <thread>
 #include <unordered_map>
 #include <vector>
-#include <map>
 #include <algorithm>
+#include <deque>
+#include <functional>
 
 #include "CachePolicy.h"
+#include "CacheNuma.h"
+#include "CacheTtl.h"
+#include "NodePool.h"
+#include "CacheStatistics.h"
+#include "FlatHashMap.h"
+#include "CacheSnapshot.h"
 
 namespace Cache {
 
+template<typename Key, typename Value> class LfuCache;
+template<typename Key, typename Value> class LfuFreqBucket;
+
 template<typename Key, typename Value>
 class LfuNode {
 public:
+    friend class LfuCache<Key, Value>;
 
-    LfuNode() : freq_(1) {}
+    LfuNode() : freq_(1), epoch_(0), prev_(nullptr), next_(nullptr)
+            , bucket_(nullptr), expireAt_(noExpire()) {}
     LfuNode(Key key, Value value)
-            : freq_(1), key_(key)
-            , value_(value)  {}
+            : freq_(1), epoch_(0)
+            , key_(std::move(key))
+            , value_(std::move(value))
+            , prev_(nullptr)
+            , next_(nullptr)
+            , bucket_(nullptr)
+            , expireAt_(noExpire()) {}
 
     Key getKey() const { return key_; }
-    Value getValue() const { return value_; }
+    //返回引用，由调用方决定拷还是不拷，省掉getter里的一次拷贝。
+    const Value &getValue() const { return value_; }
     void setValue(const Value &value) { value_ = value;}
+    //右值直接move进来，不拷贝。
+    void setValue(Value &&value) { value_ = std::move(value);}
     int getFreq() const { return freq_; }
     void incFreq() { ++freq_; }
     void setFreq(int freq) { freq_ = freq; }
+    //TTL相关。没设TTL的节点存noExpire()哨兵，先比对哨兵再取当前
+    //时间，不带TTL的访问路径上没有时钟开销。
+    ExpireTime getExpireAt() const { return expireAt_; }
+    void setExpireAt(ExpireTime expireAt) { expireAt_ = expireAt; }
+    bool isExpired() const {
+        return expireAt_ != noExpire() && CacheClock::now() >= expireAt_;
+    }
 
 private:
     int freq_;
+    //节点经历过的老化轮次，落后于缓存的当前轮次说明还欠着衰减，
+    //会在被访问或被增量扫描碰到时补上。
+    int epoch_;
     Key key_;
     Value value_;
+    //同一个频率桶内的侵入式双向链表指针。
+    LfuNode *prev_;
+    LfuNode *next_;
+    //指回自己所在的频率桶，命中提升时 O(1) 定位，不用查任何索引。
+    LfuFreqBucket<Key, Value> *bucket_;
+    //过期时间，noExpire()表示永不过期。
+    ExpireTime expireAt_;
+};
+
+/**
+ * 频率桶：相同访问频率的节点串成一条链（新节点放表尾，淘汰表头），
+ * 桶与桶之间再按频率从小到大串成双向链表。这样命中提升、淘汰、
+ * minFreq 的维护都是严格 O(1)：提升时目标频率要么就是右边相邻的桶，
+ * 要么在两桶之间新建一个桶，不需要红黑树查找，也不需要 O(n) 的
+ * 链表扫描。
+ */
+template<typename Key, typename Value>
+class LfuFreqBucket {
+public:
+    friend class LfuCache<Key, Value>;
+
+    explicit LfuFreqBucket(int freq = 0)
+            : freq_(freq)
+            , prev_(nullptr)
+            , next_(nullptr)
+            , first_(nullptr)
+            , last_(nullptr) {}
+
+private:
+    int freq_;
+    //桶链表（按频率升序）。
+    LfuFreqBucket *prev_;
+    LfuFreqBucket *next_;
+    //桶内节点链表的首尾（不带虚拟节点，空桶时都为空）。
+    LfuNode<Key, Value> *first_;
+    LfuNode<Key, Value> *last_;
 };
 
 template<typename Key, typename Value>
 class LfuCache : public CachePolicy<Key, Value> {
 public:
     using NodeType = LfuNode<Key, Value>;
-    using NodePtr = std::shared_ptr<NodeType>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
-    using FreqMap = std::map<int, std::list<NodePtr>>;
+    using NodePtr = NodeType*;
+    //key到节点的索引用扁平哈希表：槽位连续、按容量一次建好，
+    //稳态下没有rehash，探测也不追链表指针。
+    using NodeMap = FlatHashMap<Key, NodePtr>;
+    using BucketType = LfuFreqBucket<Key, Value>;
+    using BucketPtr = BucketType*;
+    //字节预算模式下用来度量value大小的函数。
+    using SizeFunc = std::function<size_t(const Value &)>;
+    //淘汰回调：收到被淘汰条目的key和value（从节点里move出来，不拷贝）。
+    using EvictionCallback = std::function<void(Key, Value)>;
+    using EvictionBatch = std::vector<std::pair<Key, Value>>;
 
+    //节点池预留 capacity 个槽位；桶最多和节点一样多（每个频率至少
+    //有一个节点），再加两个虚拟首尾桶。
     LfuCache(int capacity, int maxAverageNum = 10)
             : capacity_(capacity)
             , minFreq_(1)
             , maxAverageNum_(maxAverageNum)
             , curAverageNum_(0)
-            , curTotalNum_(0) {}
+            , curTotalNum_(0)
+            , nodePool_(capacity)
+            , bucketPool_(capacity + 2)
+            , nodeMap_(capacity) {
+        //虚拟首尾桶，简化桶链表的插入删除。
+        bucketHead_ = bucketPool_.acquire(0);
+        bucketTail_ = bucketPool_.acquire(0);
+        bucketHead_->next_ = bucketTail_;
+        bucketTail_->prev_ = bucketHead_;
+    }
+
+    /**
+     * 字节预算模式：除了条目数上限（同时也决定节点池的大小），再给
+     * 一个字节上限和度量value大小的函数。写入超出预算时按最小频率
+     * 连续淘汰多个条目，直到回到预算之内。
+     */
+    LfuCache(int capacity, size_t byteBudget, SizeFunc sizeOf, int maxAverageNum = 10)
+            : LfuCache(capacity, maxAverageNum) {
+        byteBudget_ = byteBudget;
+        sizeOf_ = std::move(sizeOf);
+    }
 
-    ~LfuCache() override = default;
+    ~LfuCache() override {
+        //singleflight的写回线程先join，再拆缓存自己的状态。
+        this->flight_.shutdown();
+        nodeMap_.forEach([this](const Key &, NodePtr node) {
+            nodePool_.release(node);
+        });
+        for(BucketPtr bucket = bucketHead_; bucket != nullptr; ) {
+            BucketPtr next = bucket->next_;
+            bucketPool_.release(bucket);
+            bucket = next;
+        }
+    }
 
     void put(Key key, Value value) override;
     bool get(Key key, Value &value) override;
     Value get(Key key) override;
+    void putMany(const std::vector<std::pair<Key, Value>> &items) override;
+    size_t getMany(const std::vector<Key> &keys,
+                   std::vector<Value> &values,
+                   std::vector<bool> &found) override;
+
+    //带TTL的写入：条目在ttl之后过期，过期后get当作未命中。内存由
+    //访问时的惰性检查和增量清扫回收，不需要定时线程轮询get刷新，
+    //频率计数也就不会被轮询污染。
+    void putWithTtl(Key key, Value value, std::chrono::milliseconds ttl);
+
+    /**
+     * 异构查找版的get：Key是std::string而查找键还是请求缓冲区里的
+     * string_view切片时，直接拿切片探测，不为每次查找在堆上物化一个
+     * std::string。命中路径和get完全一样（频率提升、记统计）。要求
+     * K2和Key可比较相等、std::hash对相同内容给相同值。
+     */
+    template<typename K2>
+    bool get(const K2 &key, Value &value) {
+        bool hit = false;
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            agingStep();
+            reapStep();
+            hit = getInternal(key, value);
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+        return hit;
+    }
+
+    //只探测不访问：不提升频率、不记统计，纯粹回答“在不在”。
+    //过期的条目当作不在，顺手回收。
+    template<typename K2>
+    bool contains(const K2 &key) {
+        bool exists = false;
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            NodePtr *found = nodeMap_.find(key);
+            if(found && (*found)->isExpired()) {
+                eraseNode(*found);
+                stats_.recordEviction();
+            }
+            else {
+                exists = found != nullptr;
+            }
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+        return exists;
+    }
+
+    //带预算hash的三个重载：分片包装器选分片时已经算过一次hash，
+    //这里直接传进来给索引探测用，省掉对长字符串key的第二次哈希。
+    //语义和不带hash的版本完全一致，hash必须是对key算出来的。
+    void put(Key key, Value value, size_t hash) {
+        if(capacity_ == 0) return ;
+
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            agingStep();
+            reapStep();
+            putInternal(key, std::move(value), noExpire(), hash);
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+    }
+
+    template<typename K2>
+    bool get(const K2 &key, Value &value, size_t hash) {
+        bool hit = false;
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            agingStep();
+            reapStep();
+            hit = getInternal(key, value, hash);
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+        return hit;
+    }
+
+    template<typename K2>
+    bool contains(const K2 &key, size_t hash) {
+        bool exists = false;
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            NodePtr *found = nodeMap_.find(key, hash);
+            if(found && (*found)->isExpired()) {
+                eraseNode(*found);
+                stats_.recordEviction();
+            }
+            else {
+                exists = found != nullptr;
+            }
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+        return exists;
+    }
+
+    //就地构造value放入缓存，避免调用方先构造临时对象再拷一遍。
+    template<typename... Args>
+    void emplace(const Key &key, Args&&... args) {
+        if(capacity_ == 0) return ;
+
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            agingStep();
+            reapStep();
+            putInternal(key, Value(std::forward<Args>(args)...));
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+    }
+
+    //读取/清零内置统计。
+    CacheStatsSnapshot getStats() const { return stats_.snapshot(); }
+    void resetStats() { stats_.reset(); }
+    //字节预算模式下当前占用的字节数（按sizeOf_度量的value大小算）。
+    size_t currentBytes() const { return curBytes_; }
+
+    /**
+     * 注册淘汰回调：容量淘汰和过期回收的条目在销毁前把key和value
+     * move给回调，脏条目的写回不用再养一张影子表。淘汰在锁内只是把
+     * 条目挪进一个手递队列，回调由触发淘汰的线程在放锁之后调用，
+     * 慢的写回不挡别的线程。回调要在开始用缓存之前注册好。
+     */
+    void setEvictionCallback(EvictionCallback cb) {
+        evictionCallback_ = std::move(cb);
+    }
+
+    /**
+     * 原地清空：节点和频率桶全部归还各自的内存池，索引槽位数组原地
+     * 重置，没有一次堆释放或分配。主动失效不算淘汰，不走淘汰回调、
+     * 不记淘汰统计。
+     */
+    void clear() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        nodeMap_.forEach([this](const Key &, NodePtr node) {
+            nodePool_.release(node);
+        });
+        nodeMap_.clear();
+        for(BucketPtr bucket = bucketHead_->next_; bucket != bucketTail_; ) {
+            BucketPtr next = bucket->next_;
+            bucketPool_.release(bucket);
+            bucket = next;
+        }
+        bucketHead_->next_ = bucketTail_;
+        bucketTail_->prev_ = bucketHead_;
+        minFreq_ = 1;
+        curTotalNum_ = 0;
+        curAverageNum_ = 0;
+        agingActive_ = false;
+        expiryQueue_.clear();
+        curBytes_ = 0;
+    }
+
+    //删除单个key。和clear一样是主动失效，不走淘汰回调。
+    bool erase(Key key) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        NodePtr *found = nodeMap_.find(key);
+        if(!found) return false;
+        eraseNode(*found, false);
+        return true;
+    }
+
+    //批量预热：一次加锁灌进整个区间，迭代器指向pair<Key, Value>。
+    //节点池和索引在构造时已按容量建好，预热全程没有rehash。
+    template<typename It>
+    void bulkLoad(It first, It last) {
+        if(capacity_ == 0) return ;
+
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for(; first != last; ++first) {
+                putInternal(first->first, first->second);
+            }
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+    }
+
+    /**
+     * 快照持久化：按频率从小到大把条目写成紧凑的二进制文件，每条
+     * 记录带着节点的访问频率；restore 重放后频率也还原回去，重启的
+     * 实例不用重新攒频率就能按原来的冷热分布淘汰。TTL是进程本地的
+     * steady_clock，不持久化：过期的条目跳过，没过期的恢复成不带
+     * TTL的条目。
+     */
+    bool snapshot(const std::string &path);
+    bool restore(const std::string &path);
+    //把本缓存的条目追加写进已打开的流，返回条目数（分片包装器用）。
+    uint64_t appendSnapshot(std::ostream &out);
+    //恢复单条快照记录，频率也一起还原。
+    void restoreEntry(uint32_t freq, Key key, Value value);
 
 private:
+    //不加锁的内部实现，供单个操作和批量操作共用。value按值传递，
+    //调用方传右值时一路move到节点里，全程零拷贝。getInternal 对
+    //查找键是模板的，异构版get直接复用同一条命中路径。带hash参数
+    //的版本给分片包装器用：选分片时算过的hash直接传进来，索引探测
+    //不再算第二次；不带的版本自己算一次，两边走同一条路径。
+    void putInternal(const Key &key, Value value, ExpireTime expireAt = noExpire()) {
+        putInternal(key, std::move(value), expireAt, TransparentHash{}(key));
+    }
+    void putInternal(const Key &key, Value value, ExpireTime expireAt, size_t hash);
+    template<typename K2>
+    bool getInternal(const K2 &key, Value &value) {
+        return getInternal(key, value, TransparentHash{}(key));
+    }
+    template<typename K2>
+    bool getInternal(const K2 &key, Value &value, size_t hash);
+    void eraseNode(NodePtr node, bool notify = true);
+    void evictOne();
+    void reapStep();
+
+    //锁外把这次操作攒下的淘汰条目交给回调。
+    void drainEvictions(EvictionBatch &batch) {
+        for(auto &entry : batch) {
+            evictionCallback_(std::move(entry.first), std::move(entry.second));
+        }
+        batch.clear();
+    }
+    //桶链表的基本操作
+    BucketPtr insertBucketAfter(BucketPtr pos, int freq);
+    void removeBucket(BucketPtr bucket);
+    //桶内节点链表的基本操作
+    void appendToBucket(BucketPtr bucket, NodePtr node);
+    void unlinkFromBucket(NodePtr node);
+
     void updateNodePos(NodePtr node);
     void updateAveAndTotalFreqNum();
-    void addNewNode(const Key &key, const Value &value);
+    void addNewNode(const Key &key, Value value, ExpireTime expireAt, size_t hash);
+    void updateMinFreq();
+    //增量老化
+    int agingDecay() const;
+    void moveNodeToFreq(NodePtr node, int newFreq);
+    void applyAging(NodePtr node);
+    void agingStep();
 
 private:
     size_t capacity_;
@@ -72,72 +420,232 @@ private:
     //当前访问所有缓存次数总数
     int curTotalNum_;
     std::mutex mutex_;
+    //节点和桶的内存池，淘汰后槽位回收复用。
+    NodePool<NodeType> nodePool_;
+    NodePool<BucketType> bucketPool_;
     //key 到缓存节点的映射
     NodeMap nodeMap_;
-    //访问频数到该频数链表的映射
-    FreqMap freqMap_;
+    //频率桶链表的虚拟首尾桶，首桶后面就是最小频率桶。
+    BucketPtr bucketHead_;
+    BucketPtr bucketTail_;
+    //命中/未命中/淘汰计数
+    CacheStatistics stats_;
+
+    //====================增量老化状态====================
+    //每个操作最多处理多少个欠衰减的节点。
+    static const int kAgingBatchSize = 8;
+    //当前老化轮次，每触发一轮老化加一。
+    int ageEpoch_ = 0;
+    //是否还有一轮老化没扫完。
+    bool agingActive_ = false;
+    //增量扫描在 nodeMap_ 槽位数组里走到的下标。
+    size_t agingSlotIdx_ = 0;
+    //游标对应的槽位总数。稳态下扁平表不扩容，这个值不会变；万一
+    //兜底扩容了，用它检测出来让游标从头再来。
+    size_t agingSlotCount_ = 0;
+
+    //====================TTL过期记录====================
+    //每次操作最多清扫多少条过期记录。
+    static const int kReapBatchSize = 8;
+    //带TTL的写入按插入顺序记在这条FIFO队列里，增量清扫从队头摘。
+    std::deque<std::pair<Key, ExpireTime>> expiryQueue_;
+
+    //====================字节预算====================
+    //字节上限，0表示只按条目数限容量。
+    size_t byteBudget_ = 0;
+    //当前占用的字节数。
+    size_t curBytes_ = 0;
+    //度量value大小的函数，只在字节预算模式下调用。
+    SizeFunc sizeOf_;
+
+    //====================淘汰回调====================
+    //空表示不关心淘汰。
+    EvictionCallback evictionCallback_;
+    //锁内攒、放锁后由同一线程清空的手递队列，只暂存当前这次操作
+    //淘汰的条目，长度天然有界。
+    EvictionBatch pendingEvictions_;
 };
 
 template<typename Key, typename Value>
-void LfuCache<Key, Value>::addNewNode(const Key &key, const Value &value) {
+typename LfuCache<Key, Value>::BucketPtr
+LfuCache<Key, Value>::insertBucketAfter(BucketPtr pos, int freq) {
+    BucketPtr bucket = bucketPool_.acquire(freq);
+    bucket->prev_ = pos;
+    bucket->next_ = pos->next_;
+    pos->next_->prev_ = bucket;
+    pos->next_ = bucket;
+    return bucket;
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::removeBucket(BucketPtr bucket) {
+    bucket->prev_->next_ = bucket->next_;
+    bucket->next_->prev_ = bucket->prev_;
+    bucketPool_.release(bucket);
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::appendToBucket(BucketPtr bucket, NodePtr node) {
+    node->bucket_ = bucket;
+    node->next_ = nullptr;
+    node->prev_ = bucket->last_;
+    if(bucket->last_)
+        bucket->last_->next_ = node;
+    else
+        bucket->first_ = node;
+    bucket->last_ = node;
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::unlinkFromBucket(NodePtr node) {
+    BucketPtr bucket = node->bucket_;
+    if(node->prev_)
+        node->prev_->next_ = node->next_;
+    else
+        bucket->first_ = node->next_;
+    if(node->next_)
+        node->next_->prev_ = node->prev_;
+    else
+        bucket->last_ = node->prev_;
+    node->prev_ = node->next_ = nullptr;
+    node->bucket_ = nullptr;
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::updateMinFreq() {
+    if(bucketHead_->next_ == bucketTail_)
+        minFreq_ = 1;
+    else
+        minFreq_ = bucketHead_->next_->freq_;
+}
+
+//把一个节点从缓存里整个摘掉，并修正频率统计。
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::eraseNode(NodePtr node, bool notify) {
+    if(byteBudget_ > 0) {
+        curBytes_ -= sizeOf_(node->getValue());
+    }
+    nodeMap_.erase(node->getKey());
+    BucketPtr bucket = node->bucket_;
+    unlinkFromBucket(node);
+    if(bucket->first_ == nullptr) {
+        removeBucket(bucket);
+    }
+    curTotalNum_ -= node->getFreq();
+    if(notify && evictionCallback_) {
+        //key和value直接从节点里move进手递队列，节点槽位照常回收。
+        pendingEvictions_.emplace_back(std::move(node->key_),
+                                       std::move(node->value_));
+    }
+    nodePool_.release(node);
+    if(nodeMap_.empty())
+        curAverageNum_ = 0;
+    else
+        curAverageNum_ = curTotalNum_ / nodeMap_.size();
+    updateMinFreq();
+}
+
+//淘汰一个节点：最小频率桶就是首桶后面的桶，淘汰它的表头节点
+//（同频率下最久未访问的）。
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::evictOne() {
+    BucketPtr minBucket = bucketHead_->next_;
+    if(minBucket == bucketTail_) return ;
+    eraseNode(minBucket->first_);
+    stats_.recordEviction();
+}
+
+/**
+ * 增量清扫过期条目：过期记录按写入顺序排在FIFO队列里，每次操作顺手
+ * 从队头摘一小批已经到期的，不用扫 nodeMap_。条目被重新put过的话
+ * 过期时间对不上，旧记录直接作废；各条目TTL不一致时队头可能还没到期
+ * 而后面的已经到期，这种条目留给访问时的惰性检查兜底。
+ */
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::reapStep() {
+    if(expiryQueue_.empty()) return ;
+
+    ExpireTime now = CacheClock::now();
+    int budget = kReapBatchSize;
+    while(budget-- > 0 && !expiryQueue_.empty()) {
+        const auto &record = expiryQueue_.front();
+        if(record.second > now) break;
+        NodePtr *found = nodeMap_.find(record.first);
+        //条目可能已被淘汰或重新put过（过期时间对不上），记录作废。
+        if(found && (*found)->getExpireAt() == record.second) {
+            eraseNode(*found);
+            stats_.recordEviction();
+        }
+        expiryQueue_.pop_front();
+    }
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::addNewNode(const Key &key, Value value, ExpireTime expireAt, size_t hash) {
+    //字节要在value被move走之前量好。
+    size_t bytes = byteBudget_ > 0 ? sizeOf_(value) : 0;
     if(nodeMap_.size() >= capacity_) {
-        //缓存已满，需要淘汰一个节点，淘汰从表头删除
-        auto node = freqMap_[minFreq_].front();
-        nodeMap_.erase(node->getKey());
-        freqMap_[minFreq_].pop_front();
-
-        //更新当前总访问频率和平均访问频率
-        curTotalNum_ -= minFreq_;
-        if(nodeMap_.empty())
-            curAverageNum_ = 0;
-        else
-            curAverageNum_ = curTotalNum_ / nodeMap_.size();
-        
-        if(freqMap_[minFreq_].empty()) {
-            freqMap_.erase(minFreq_);
-            //更新最小频率
-            // minFreq_ = INT8_MAX;
-            // for(const auto &pair : freqMap_) {
-            //     if(pair.first < minFreq_)
-            //         minFreq_ = pair.first;
-            // }
-            // if(minFreq_ == INT8_MAX) minFreq_ = 1;
-            minFreq_ = freqMap_.begin()->first;
-        }
-    }
-
-    //创建新节点，并加入到缓存中，更新最小访问频率
-    NodePtr node = std::make_shared<NodeType>(key, value);
-    nodeMap_[key] = node;
-    if(freqMap_.find(1) == freqMap_.end()) {
-        freqMap_[1] = std::list<NodePtr>();
-    }
-    freqMap_[1].push_back(node);
+        //缓存已满，需要淘汰一个节点。
+        evictOne();
+    }
+
+    //创建新节点，放进频率为1的桶。频率1的桶如果存在，一定是首桶
+    //后面的第一个桶，不存在就在那个位置新建一个。
+    NodePtr node = nodePool_.acquire(key, std::move(value));
+    //新节点不欠任何衰减。
+    node->epoch_ = ageEpoch_;
+    node->setExpireAt(expireAt);
+    nodeMap_.findOrInsert(key, hash) = node;
+    BucketPtr firstBucket = bucketHead_->next_;
+    if(firstBucket == bucketTail_ || firstBucket->freq_ != 1) {
+        firstBucket = insertBucketAfter(bucketHead_, 1);
+    }
+    appendToBucket(firstBucket, node);
     minFreq_ = 1;
 
     updateAveAndTotalFreqNum();
+
+    if(byteBudget_ > 0) {
+        curBytes_ += bytes;
+        //大value可能一次顶掉多个小条目，一直淘汰到回到预算之内。
+        //新节点频率为1且在桶尾，只有整个缓存都装不下它时才会淘汰
+        //到它自己。
+        while(curBytes_ > byteBudget_ && !nodeMap_.empty()) {
+            evictOne();
+        }
+    }
 }
 
 template<typename Key, typename Value>
 void LfuCache<Key, Value>::updateNodePos(NodePtr node) {
 
-    int oldFreq = node->getFreq();
+    //先把欠着的衰减补上，再做这次访问的提升。
+    applyAging(node);
+
+    BucketPtr oldBucket = node->bucket_;
     node->incFreq();
     int newFreq = node->getFreq();
 
-    auto &oldList = freqMap_[oldFreq];
-    oldList.remove(node);
-    if(oldList.empty()) {
-        freqMap_.erase(oldFreq);
-        if(minFreq_ == oldFreq) {
-            minFreq_ = newFreq;
+    BucketPtr nextBucket = oldBucket->next_;
+    if(nextBucket != bucketTail_ && nextBucket->freq_ == newFreq) {
+        //右边相邻的桶正好是新频率，直接挪过去。
+        unlinkFromBucket(node);
+        if(oldBucket->first_ == nullptr) {
+            removeBucket(oldBucket);
         }
+        appendToBucket(nextBucket, node);
     }
-
-    if(freqMap_.find(newFreq) == freqMap_.end()) {
-        freqMap_[newFreq] = std::list<NodePtr>();
+    else if(oldBucket->first_ == node && oldBucket->last_ == node) {
+        //桶里只有这一个节点，且右边没有新频率的桶，直接把桶的
+        //频率改掉，省一次桶的创建和销毁。
+        oldBucket->freq_ = newFreq;
+    }
+    else {
+        //在旧桶右边新建一个新频率的桶。
+        unlinkFromBucket(node);
+        appendToBucket(insertBucketAfter(oldBucket, newFreq), node);
     }
-    freqMap_[newFreq].push_back(node);
+    updateMinFreq();
 
     //总访问频率数和当前平均访问频率数都要更新。
     updateAveAndTotalFreqNum();
@@ -150,74 +658,240 @@ void LfuCache<Key, Value>::updateAveAndTotalFreqNum() {
         curAverageNum_ = 0;
     else
         curAverageNum_ = curTotalNum_ / nodeMap_.size();
-    
-    if(curAverageNum_ > maxAverageNum_) {
+
+    if(curAverageNum_ > maxAverageNum_ && !agingActive_) {
         //当前平均访问频率大于最大平均访问频率，则需要进行老化数据处理，防止
         //频率很大的数据现在不常访问了，但是现在常访问的数据频率因为低于它导致
         //淘汰不了它，长期占据内存，所以需要对那些数据进行老化处理。
-        if(nodeMap_.empty()) return ;
-
-        //所有节点的频率减去（maxAverageNum_ / 2)
-        for(auto it = nodeMap_.begin(); it != nodeMap_.end(); ++it) {
-            if(!it->second) continue;
-
-            NodePtr node = it->second;
-            int oldFreq = node->getFreq();
-            int newFreq = node->getFreq() - (maxAverageNum_ / 2);
-            if(newFreq < 1) newFreq = 1;
-            node->setFreq(newFreq);
-            auto &oldList = freqMap_[oldFreq];
-
-            //先从当前频率链表中移除
-            oldList.remove(node);
-            if(oldList.empty()) {
-                freqMap_.erase(oldFreq);
-            }
+        //
+        //这里只是把老化轮次加一，并不马上遍历所有节点（整表遍历在大缓存上
+        //是毫秒级的停顿）。真正的衰减由两条路摊还完成：节点被访问时在
+        //applyAging 里补上欠的衰减；没被访问的节点由 agingStep 每次操作
+        //扫一小批补上。上一轮没扫完之前不会再开新的一轮。
+        ++ageEpoch_;
+        agingActive_ = true;
+        agingSlotIdx_ = 0;
+        agingSlotCount_ = nodeMap_.slotCount();
+    }
+}
 
-            //添加到新位置。
-            if(freqMap_.find(newFreq) == freqMap_.end()) {
-                freqMap_[newFreq] = std::list<NodePtr>();
-            }
-            freqMap_[newFreq].push_back(node);
+template<typename Key, typename Value>
+int LfuCache<Key, Value>::agingDecay() const {
+    //每轮老化每个节点要衰减的频率，至少为1，否则老化不起作用。
+    int decay = maxAverageNum_ / 2;
+    return decay < 1 ? 1 : decay;
+}
+
+//把节点挪到指定频率的桶里。目标桶从表头开始找：衰减后的频率都很小，
+//基本落在最前面的几个桶里。
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::moveNodeToFreq(NodePtr node, int newFreq) {
+    BucketPtr oldBucket = node->bucket_;
+    unlinkFromBucket(node);
+    if(oldBucket->first_ == nullptr) {
+        removeBucket(oldBucket);
+    }
+    node->setFreq(newFreq);
+
+    BucketPtr pos = bucketHead_;
+    while(pos->next_ != bucketTail_ && pos->next_->freq_ < newFreq) {
+        pos = pos->next_;
+    }
+    BucketPtr target = pos->next_;
+    if(target == bucketTail_ || target->freq_ != newFreq) {
+        target = insertBucketAfter(pos, newFreq);
+    }
+    appendToBucket(target, node);
+    updateMinFreq();
+}
+
+//补上节点欠的衰减：落后几轮就减几次 agingDecay()，频率最低减到1。
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::applyAging(NodePtr node) {
+    if(node->epoch_ == ageEpoch_) return ;
+
+    int behind = ageEpoch_ - node->epoch_;
+    node->epoch_ = ageEpoch_;
+    int newFreq = node->getFreq() - behind * agingDecay();
+    if(newFreq < 1) newFreq = 1;
+    if(newFreq == node->getFreq()) return ;
+
+    curTotalNum_ -= node->getFreq() - newFreq;
+    moveNodeToFreq(node, newFreq);
+}
+
+//增量扫描：沿着 nodeMap_ 的槽位数组往前走，每次最多看 kAgingBatchSize
+//个槽位，把没被访问过、还欠着衰减的节点补上。补衰减只挪频率桶，不动
+//nodeMap_ 本身；中间穿插的插入删除顶多让条目在相邻槽位间小挪几步，
+//漏看的节点留给下一轮或被访问时的 applyAging 兜底，补过的有轮次标记
+//不会重复衰减。
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::agingStep() {
+    if(!agingActive_) return ;
+
+    if(nodeMap_.slotCount() != agingSlotCount_) {
+        agingSlotIdx_ = 0;
+        agingSlotCount_ = nodeMap_.slotCount();
+    }
+
+    //预算按“看过的槽位数”算，空槽也记成本，保证单次操作的老化
+    //工作量有常数上界。
+    int budget = kAgingBatchSize;
+    while(budget-- > 0 && agingSlotIdx_ < agingSlotCount_) {
+        if(nodeMap_.occupiedAt(agingSlotIdx_)) {
+            applyAging(nodeMap_.valueAt(agingSlotIdx_));
+        }
+        ++agingSlotIdx_;
+    }
+
+    if(agingSlotIdx_ >= agingSlotCount_) {
+        //整轮扫完了，之后如果平均频率还是太高，会再开新的一轮。
+        agingActive_ = false;
+    }
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::putInternal(const Key &key, Value value, ExpireTime expireAt, size_t hash) {
+    stats_.recordPut();
+    NodePtr *found = nodeMap_.find(key, hash);
+    if(found) {
+        NodePtr node = *found;
+        if(byteBudget_ > 0) {
+            //先加后减，避免无符号数中途下溢。
+            curBytes_ += sizeOf_(value);
+            curBytes_ -= sizeOf_(node->getValue());
+        }
+        //如果缓存中已经有这个 key，则更新其 value
+        node->setValue(std::move(value));
+        //重新put会刷新过期时间（包括从有TTL改成没TTL）。
+        node->setExpireAt(expireAt);
+        //因为访问了，频率变化，要调整位置
+        updateNodePos(node);
+        //value变大可能把缓存顶出预算。
+        while(byteBudget_ > 0 && curBytes_ > byteBudget_ && !nodeMap_.empty()) {
+            evictOne();
         }
+    }
+    else {
+        addNewNode(key, std::move(value), expireAt, hash);
+    }
+    if(expireAt != noExpire()) {
+        expiryQueue_.emplace_back(key, expireAt);
+    }
+}
 
-        //更新最小频率
-        // minFreq_ = INT8_MAX;
-        // for(const auto &pair : freqMap_) {
-        //     if(pair.first < minFreq_)
-        //         minFreq_ = pair.first;
-        // }
-        // if(minFreq_ == INT8_MAX) minFreq_ = 1;
-        minFreq_ = freqMap_.begin()->first;
+template<typename Key, typename Value>
+template<typename K2>
+bool LfuCache<Key, Value>::getInternal(const K2 &key, Value &value, size_t hash) {
+    NodePtr *found = nodeMap_.find(key, hash);
+    if(found) {
+        NodePtr node = *found;
+        if(node->isExpired()) {
+            //过期的条目不算命中，顺手把它回收掉。
+            eraseNode(node);
+            stats_.recordEviction();
+            stats_.recordMiss();
+            return false;
+        }
+        value = node->getValue();
+        updateNodePos(node);
+        stats_.recordHit();
+        return true;
     }
+    stats_.recordMiss();
+    return false;
 }
 
 template<typename Key, typename Value>
 void LfuCache<Key, Value>::put(Key key, Value value) {
     if(capacity_ == 0) return ;
 
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = nodeMap_.find(key);
-    if(it != nodeMap_.end()) {
-        //如果缓存中已经有这个 key，则更新其 value 
-        it->second->setValue(value);
-        //因为访问了，频率变化，要调整位置
-        updateNodePos(it->second);
-        return ;
+    EvictionBatch evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        //顺手做一小批增量老化和过期清扫。
+        agingStep();
+        reapStep();
+        putInternal(key, std::move(value));
+        evicted.swap(pendingEvictions_);
+    }
+    //淘汰回调在锁外调用，慢的写回不挡别的线程。
+    drainEvictions(evicted);
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::putWithTtl(Key key, Value value, std::chrono::milliseconds ttl) {
+    if(capacity_ == 0) return ;
+
+    EvictionBatch evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        agingStep();
+        reapStep();
+        putInternal(key, std::move(value), CacheClock::now() + ttl);
+        evicted.swap(pendingEvictions_);
     }
-    addNewNode(key, value);
+    drainEvictions(evicted);
 }
 
 template<typename Key, typename Value>
 bool LfuCache<Key, Value>::get(Key key, Value &value) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = nodeMap_.find(key);
-    if(it != nodeMap_.end()) {
-        value = it->second->getValue();
-        updateNodePos(it->second);
-        return true;
+    bool hit = false;
+    EvictionBatch evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        //顺手做一小批增量老化和过期清扫。
+        agingStep();
+        reapStep();
+        hit = getInternal(key, value);
+        evicted.swap(pendingEvictions_);
     }
-    return false;
+    drainEvictions(evicted);
+    return hit;
+}
+
+//批量写：整批只加一次锁，增量老化整批也只做一次。
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::putMany(const std::vector<std::pair<Key, Value>> &items) {
+    if(capacity_ == 0) return ;
+
+    EvictionBatch evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        agingStep();
+        reapStep();
+        for(const auto &item : items) {
+            putInternal(item.first, item.second);
+        }
+        evicted.swap(pendingEvictions_);
+    }
+    drainEvictions(evicted);
+}
+
+//批量读：整批只加一次锁。
+template<typename Key, typename Value>
+size_t LfuCache<Key, Value>::getMany(const std::vector<Key> &keys,
+                                     std::vector<Value> &values,
+                                     std::vector<bool> &found) {
+    values.assign(keys.size(), Value{});
+    found.assign(keys.size(), false);
+    size_t hitCount = 0;
+
+    EvictionBatch evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        agingStep();
+        reapStep();
+        for(size_t i = 0; i < keys.size(); ++i) {
+            if(getInternal(keys[i], values[i])) {
+                found[i] = true;
+                ++hitCount;
+            }
+        }
+        evicted.swap(pendingEvictions_);
+    }
+    drainEvictions(evicted);
+    return hitCount;
 }
 
 template<typename Key, typename Value>
@@ -227,26 +901,147 @@ Value LfuCache<Key, Value>::get(Key key) {
     return value;
 }
 
+//按频率从小到大、桶内从最久未访问到最近访问的顺序写出，恢复时
+//同频率条目的新旧次序也就保住了。
+template<typename Key, typename Value>
+uint64_t LfuCache<Key, Value>::appendSnapshot(std::ostream &out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t count = 0;
+    for(BucketPtr bucket = bucketHead_->next_; bucket != bucketTail_;
+        bucket = bucket->next_) {
+        for(NodePtr node = bucket->first_; node != nullptr; node = node->next_) {
+            //过期的条目不值得带进下一个进程。
+            if(node->isExpired()) continue;
+            uint32_t freq = static_cast<uint32_t>(node->getFreq());
+            if(!snapshotWrite(out, freq) || !snapshotWrite(out, node->getKey())
+               || !snapshotWrite(out, node->getValue())) {
+                return count;
+            }
+            ++count;
+        }
+    }
+    return count;
+}
+
+template<typename Key, typename Value>
+bool LfuCache<Key, Value>::snapshot(const std::string &path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if(!out) return false;
+    //条目数先占位，记录写完再回头补上。
+    if(!snapshotWriteHeader(out, 0)) return false;
+    uint64_t count = appendSnapshot(out);
+    return snapshotPatchCount(out, count);
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::restoreEntry(uint32_t freq, Key key, Value value) {
+    if(capacity_ == 0) return ;
+    if(freq < 1) freq = 1;
+
+    EvictionBatch evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        putInternal(key, std::move(value));
+        NodePtr *found = nodeMap_.find(key);
+        if(found && (*found)->getFreq() != static_cast<int>(freq)) {
+            //把快照里的频率还原回去，总频率和平均频率跟着修正。
+            curTotalNum_ += static_cast<int>(freq) - (*found)->getFreq();
+            moveNodeToFreq(*found, static_cast<int>(freq));
+            if(!nodeMap_.empty()) {
+                curAverageNum_ = curTotalNum_ / nodeMap_.size();
+            }
+        }
+        evicted.swap(pendingEvictions_);
+    }
+    drainEvictions(evicted);
+}
+
+template<typename Key, typename Value>
+bool LfuCache<Key, Value>::restore(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if(!in) return false;
+    uint64_t count = 0;
+    if(!snapshotReadHeader(in, count)) return false;
+    for(uint64_t i = 0; i < count; ++i) {
+        uint32_t freq = 0;
+        Key key{};
+        Value value{};
+        if(!snapshotRead(in, freq) || !snapshotRead(in, key)
+           || !snapshotRead(in, value)) {
+            return false;
+        }
+        restoreEntry(freq, std::move(key), std::move(value));
+    }
+    return true;
+}
+
 template<typename Key, typename Value>
 class HashLfuCaches : public CachePolicy<Key, Value> {
 public:
+    //分片数向上取整到2的幂，选分片时用位与代替整数取模。
     HashLfuCaches(size_t capacity, int sliceNum = std::thread::hardware_concurrency(), int maxAverageNum = 10)
-                : sliceNum_(sliceNum)
-                , capacity_(capacity) {
-        
-        size_t sliceSize = std::ceil(capacity_ / static_cast<double>(sliceNum));
-        for(int i = 0; i < sliceNum_; ++i) 
+                : capacity_(capacity)
+                , sliceNum_(roundUpPow2(sliceNum))
+                , sliceMask_(sliceNum_ - 1) {
+
+        //份额按取整后的分片数算：按原始的sliceNum除会让每个分片偏
+        //大，分片数取整到2的幂之后总容量悄悄超出调用方要的上限。
+        size_t sliceSize = std::ceil(capacity_ / static_cast<double>(sliceNum_));
+        for(int i = 0; i < sliceNum_; ++i)
             lfuSliceCaches_.emplace_back(new LfuCache<Key, Value>(sliceSize, maxAverageNum));
     }
 
+    //NUMA交错构造：每个分片在自己的一条绑核线程上构造，借助
+    //first-touch把分片内存铺到各个节点（见 CacheNuma.h 和
+    //HashLruCaches对应构造函数的说明）。
+    HashLfuCaches(NumaInterleaved, size_t capacity,
+                  int sliceNum = std::thread::hardware_concurrency(),
+                  int maxAverageNum = 10)
+                : capacity_(capacity)
+                , sliceNum_(roundUpPow2(sliceNum))
+                , sliceMask_(sliceNum_ - 1) {
+
+        size_t sliceSize = std::ceil(capacity_ / static_cast<double>(sliceNum_));
+        lfuSliceCaches_.resize(sliceNum_);
+        constructShardsInterleaved(sliceNum_, [this, sliceSize, maxAverageNum](size_t i) {
+            lfuSliceCaches_[i].reset(new LfuCache<Key, Value>(sliceSize, maxAverageNum));
+        });
+    }
+
+    //字节预算模式：条目数和字节预算都按分片数均分，每个分片独立
+    //在自己的份额内淘汰。
+    HashLfuCaches(size_t capacity, size_t byteBudget,
+                  typename LfuCache<Key, Value>::SizeFunc sizeOf,
+                  int sliceNum = std::thread::hardware_concurrency(),
+                  int maxAverageNum = 10)
+                : capacity_(capacity)
+                , sliceNum_(roundUpPow2(sliceNum))
+                , sliceMask_(sliceNum_ - 1) {
+
+        size_t sliceSize = std::ceil(capacity_ / static_cast<double>(sliceNum_));
+        size_t sliceBudget = std::ceil(byteBudget / static_cast<double>(sliceNum_));
+        for(int i = 0; i < sliceNum_; ++i)
+            lfuSliceCaches_.emplace_back(
+                new LfuCache<Key, Value>(sliceSize, sliceBudget, sizeOf, maxAverageNum));
+    }
+
+    //getOrLoad转发给分片，自己的在途表正常情况下是空的；这里的
+    //shutdown是兜底，真正的加载线程由各分片析构时自己join。
+    ~HashLfuCaches() override { this->flight_.shutdown(); }
+
     void put(Key key, Value value) {
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        return lfuSliceCaches_[sliceIndex]->put(key, value);
+        //key的hash在这里只算一次，分片用低位掩码选，再把同一个hash
+        //传给分片做索引探测（分片内的扁平表会把hash再搅一遍，低位
+        //相同的key在分片内仍然能散开）。
+        size_t hash = Hash(key);
+        size_t sliceIndex = hash & sliceMask_;
+        return lfuSliceCaches_[sliceIndex]->put(key, value, hash);
     }
 
     bool get(Key key, Value &value) {
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        return lfuSliceCaches_[sliceIndex]->get(key, value);
+        size_t hash = Hash(key);
+        size_t sliceIndex = hash & sliceMask_;
+        return lfuSliceCaches_[sliceIndex]->get(key, value, hash);
     }
 
     Value get(Key key) {
@@ -255,20 +1050,188 @@ public:
         return value;
     }
 
-    void removeCache() {
-        for(auto &cache : lfuSliceCaches_)
-            cache->removeCache();
+    //异构查找版的get/contains：选分片和分片内的探测都直接用原始的
+    //key切片，整条查找路径不物化Key，hash也只算这一次。
+    template<typename K2>
+    bool get(const K2 &key, Value &value) {
+        size_t hash = Hash(key);
+        size_t sliceIndex = hash & sliceMask_;
+        return lfuSliceCaches_[sliceIndex]->get(key, value, hash);
+    }
+
+    template<typename K2>
+    bool contains(const K2 &key) {
+        size_t hash = Hash(key);
+        size_t sliceIndex = hash & sliceMask_;
+        return lfuSliceCaches_[sliceIndex]->contains(key, hash);
+    }
+
+    //逐个分片原地清空，分片锁挨个拿，不需要停全局的流量。
+    void clear() override {
+        for(auto &cache : lfuSliceCaches_) {
+            cache->clear();
+        }
+    }
+
+    bool erase(Key key) override {
+        return lfuSliceCaches_[Hash(key) & sliceMask_]->erase(key);
+    }
+
+    //批量预热：按分片分组后整组灌进对应分片，每个分片的锁只拿一次。
+    template<typename It>
+    void bulkLoad(It first, It last) {
+        std::vector<std::vector<std::pair<Key, Value>>> sliceItems(sliceNum_);
+        for(; first != last; ++first) {
+            sliceItems[Hash(first->first) & sliceMask_].emplace_back(
+                first->first, first->second);
+        }
+        for(int i = 0; i < sliceNum_; ++i) {
+            if(!sliceItems[i].empty()) {
+                lfuSliceCaches_[i]->bulkLoad(sliceItems[i].begin(),
+                                             sliceItems[i].end());
+            }
+        }
+    }
+
+    //批量写：先按分片分组，每个分片整批写入，分片锁各拿一次。
+    void putMany(const std::vector<std::pair<Key, Value>> &items) {
+        std::vector<std::vector<std::pair<Key, Value>>> sliceItems(sliceNum_);
+        for(const auto &item : items) {
+            sliceItems[Hash(item.first) & sliceMask_].push_back(item);
+        }
+        for(int i = 0; i < sliceNum_; ++i) {
+            if(!sliceItems[i].empty()) {
+                lfuSliceCaches_[i]->putMany(sliceItems[i]);
+            }
+        }
+    }
+
+    //批量读：按分片分组查询，再按原顺序把结果散列回去。
+    size_t getMany(const std::vector<Key> &keys,
+                   std::vector<Value> &values,
+                   std::vector<bool> &found) {
+        values.assign(keys.size(), Value{});
+        found.assign(keys.size(), false);
+
+        //每个分片要查的key以及它们在原批次中的下标。
+        std::vector<std::vector<Key>> sliceKeys(sliceNum_);
+        std::vector<std::vector<size_t>> sliceIndexes(sliceNum_);
+        for(size_t i = 0; i < keys.size(); ++i) {
+            size_t sliceIndex = Hash(keys[i]) & sliceMask_;
+            sliceKeys[sliceIndex].push_back(keys[i]);
+            sliceIndexes[sliceIndex].push_back(i);
+        }
+
+        size_t hitCount = 0;
+        std::vector<Value> sliceValues;
+        std::vector<bool> sliceFound;
+        for(int s = 0; s < sliceNum_; ++s) {
+            if(sliceKeys[s].empty()) continue;
+            hitCount += lfuSliceCaches_[s]->getMany(sliceKeys[s], sliceValues, sliceFound);
+            for(size_t j = 0; j < sliceKeys[s].size(); ++j) {
+                if(sliceFound[j]) {
+                    values[sliceIndexes[s][j]] = sliceValues[j];
+                    found[sliceIndexes[s][j]] = true;
+                }
+            }
+        }
+        return hitCount;
+    }
+
+    //每个分片注册同一个淘汰回调，各分片在自己的锁外交付。
+    void setEvictionCallback(typename LfuCache<Key, Value>::EvictionCallback cb) {
+        for(auto &cache : lfuSliceCaches_) {
+            cache->setEvictionCallback(cb);
+        }
+    }
+
+    //快照/恢复：所有分片拼成一个文件，分片锁挨个拿，写快照不用
+    //停全局的流量。恢复时按key的hash重新路由。
+    bool snapshot(const std::string &path) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if(!out) return false;
+        if(!snapshotWriteHeader(out, 0)) return false;
+        uint64_t count = 0;
+        for(auto &cache : lfuSliceCaches_) {
+            count += cache->appendSnapshot(out);
+        }
+        return snapshotPatchCount(out, count);
+    }
+
+    bool restore(const std::string &path) {
+        std::ifstream in(path, std::ios::binary);
+        if(!in) return false;
+        uint64_t count = 0;
+        if(!snapshotReadHeader(in, count)) return false;
+        for(uint64_t i = 0; i < count; ++i) {
+            uint32_t freq = 0;
+            Key key{};
+            Value value{};
+            if(!snapshotRead(in, freq) || !snapshotRead(in, key)
+               || !snapshotRead(in, value)) {
+                return false;
+            }
+            size_t sliceIndex = Hash(key) & sliceMask_;
+            lfuSliceCaches_[sliceIndex]->restoreEntry(freq, std::move(key),
+                                                      std::move(value));
+        }
+        return true;
+    }
+
+    //读穿透转发给对应的分片，让singleflight的在途表按分片拆开。
+    Value getOrLoad(Key key, const typename CachePolicy<Key, Value>::Loader &loader) override {
+        return lfuSliceCaches_[Hash(key) & sliceMask_]->getOrLoad(key, loader);
+    }
+
+    std::shared_future<Value> getOrLoadAsync(Key key,
+            const typename CachePolicy<Key, Value>::Loader &loader) override {
+        return lfuSliceCaches_[Hash(key) & sliceMask_]->getOrLoadAsync(key, loader);
+    }
+
+    //聚合所有分片的统计。
+    CacheStatsSnapshot getStats() const {
+        CacheStatsSnapshot total;
+        for(const auto &cache : lfuSliceCaches_) {
+            total += cache->getStats();
+        }
+        return total;
+    }
+
+    //逐分片的统计，下标就是分片号：某个分片的淘汰/未命中远高于
+    //其他分片就是热分片，可以直接拿来定位倾斜的key分布。
+    std::vector<CacheStatsSnapshot> getSliceStats() const {
+        std::vector<CacheStatsSnapshot> stats;
+        stats.reserve(lfuSliceCaches_.size());
+        for(const auto &cache : lfuSliceCaches_) {
+            stats.push_back(cache->getStats());
+        }
+        return stats;
     }
 
 private:
-    size_t Hash(Key key) {
-        std::hash<Key> hashFunc;
-        return hashFunc(key);
+    //对查找键的类型做哈希：string_view 之类的异构key不用先物化成
+    //Key就能选分片。必须和分片内索引用同一个 TransparentHash——
+    //它对 const char* 按内容哈希，std::hash<const char*> 却是按指针
+    //哈希，两边不一致的话查找会被路由到随机的分片上，明明在缓存里
+    //的key也查不到。
+    template<typename K2>
+    size_t Hash(const K2 &key) {
+        return TransparentHash{}(key);
+    }
+
+    //把分片数向上取整到2的幂。
+    static int roundUpPow2(int n) {
+        int p = 1;
+        while(p < n) p <<= 1;
+        return p;
     }
 
 private:
     size_t capacity_;
+    //切片数量（2的幂）
     int sliceNum_;
+    //选分片用的掩码，等于 sliceNum_ - 1。
+    size_t sliceMask_;
     //缓存分片容器
     std::vector<std::unique_ptr<LfuCache<Key, Value>>> lfuSliceCaches_;
 };
@@ -2,13 +2,24 @@
 
 #include <mutex>
 #include <unordered_map>
+#include <cmath>
+#include <algorithm>
 #include <cstring>
 #include <list>
 #include <memory>
 #include <vector>
 #include <thread>
+#include <deque>
+#include <functional>
 
 #include "CachePolicy.h"
+#include "CacheNuma.h"
+#include "CacheTtl.h"
+#include "NodePool.h"
+#include "CacheStatistics.h"
+#include "FrequencySketch.h"
+#include "FlatHashMap.h"
+#include "CacheSnapshot.h"
 
 namespace Cache {
 
@@ -20,64 +31,443 @@ public:
     friend class LruCache<Key, Value>;
 
     LruNode(Key key, Value value)
-        : key_(key)
-        , value_(value)
+        : key_(std::move(key))
+        , value_(std::move(value))
         , accessCount_(1)
         , prev_(nullptr)
-        , next_(nullptr) {}
+        , next_(nullptr)
+        , expireAt_(noExpire()) {}
 
     //提供必要的访问器，因为其它类需要访问这个类的私有成员时，
     //可以用公共接口来访问。
     Key getKey() const {return key_; }
-    Value getValue() const {return value_; }
+    //返回引用，由调用方决定拷还是不拷，省掉getter里的一次拷贝。
+    const Value &getValue() const {return value_; }
     void setValue(const Value &value) {value_ = value; }
+    //右值直接move进来，不拷贝。
+    void setValue(Value &&value) {value_ = std::move(value); }
     size_t getAccessCount() const {return accessCount_; }
     void incAccessCount() {++accessCount_; }
+    //TTL相关。没设TTL的节点存的是noExpire()哨兵，先比对哨兵再取
+    //当前时间，不带TTL的访问路径上没有任何时钟开销。
+    ExpireTime getExpireAt() const {return expireAt_; }
+    void setExpireAt(ExpireTime expireAt) {expireAt_ = expireAt; }
+    bool isExpired() const {
+        return expireAt_ != noExpire() && CacheClock::now() >= expireAt_;
+    }
 
 private:
     Key key_;
     Value value_;
     size_t accessCount_;
-    std::shared_ptr<LruNode<Key, Value>> prev_;
-    std::shared_ptr<LruNode<Key, Value>> next_;
+    //侵入式双向链表的裸指针，节点的所有权在缓存手里（节点池），
+    //链表操作不再有 shared_ptr 的原子引用计数开销，大缓存析构
+    //时也不会沿着链表递归。
+    LruNode<Key, Value> *prev_;
+    LruNode<Key, Value> *next_;
+    //过期时间，noExpire()表示永不过期。
+    ExpireTime expireAt_;
 };
 
 template<typename Key, typename Value>
 class LruCache : public CachePolicy<Key, Value> {
 public:
     using LruNodeType = LruNode<Key, Value>;
-    using NodePtr = std::shared_ptr<LruNodeType>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
+    using NodePtr = LruNodeType*;
+    //key到节点的索引用扁平哈希表：槽位连续、按容量一次建好，
+    //稳态下没有rehash，探测也不追链表指针。
+    using NodeMap = FlatHashMap<Key, NodePtr>;
+    //字节预算模式下用来度量value大小的函数。
+    using SizeFunc = std::function<size_t(const Value &)>;
+    //淘汰回调：收到被淘汰条目的key和value（从节点里move出来，不拷贝）。
+    using EvictionCallback = std::function<void(Key, Value)>;
+    using EvictionBatch = std::vector<std::pair<Key, Value>>;
 
-    LruCache(size_t capacity) : capacity_(capacity) {
+    //节点池预留 capacity 个数据槽位，外加两个给虚拟头尾节点。
+    LruCache(size_t capacity)
+            : capacity_(capacity)
+            , nodePool_(capacity + 2)
+            , nodeMap_(capacity) {
         //私有成员中只是定义了头尾节点的指针，还没有分配内存，所以
         //构造时要替它们分配内存，并将它们串成一个环，因为是双向链表。
-        dummyHead_ = std::make_shared<LruNodeType>(Key(), Value());
-        dummyTail_ = std::make_shared<LruNodeType>(Key(), Value());
+        dummyHead_ = nodePool_.acquire(Key(), Value());
+        dummyTail_ = nodePool_.acquire(Key(), Value());
         dummyHead_->next_ = dummyTail_;
         dummyTail_->prev_ = dummyHead_;
     }
 
-    ~LruCache() override = default;
+    /**
+     * 字节预算模式：除了条目数上限（同时也决定节点池的大小），再给
+     * 一个字节上限和度量value大小的函数。value大小参差不齐时按条目
+     * 数限容量要么浪费内存要么超卖内存，按字节限就没这个问题。写入
+     * 超出预算时从淘汰端连续淘汰多个条目，直到回到预算之内。
+     */
+    LruCache(size_t capacity, size_t byteBudget, SizeFunc sizeOf)
+            : LruCache(capacity) {
+        byteBudget_ = byteBudget;
+        sizeOf_ = std::move(sizeOf);
+    }
+
+    //节点都是从池子里拿的裸指针，析构时逐个归还槽位。先把基类里的
+    //singleflight停掉：它的工作线程会往本缓存写回，必须在锁、索引、
+    //内存池拆掉之前join完。
+    ~LruCache() override {
+        this->flight_.shutdown();
+        nodeMap_.forEach([this](const Key &, NodePtr node) {
+            nodePool_.release(node);
+        });
+        nodePool_.release(dummyHead_);
+        nodePool_.release(dummyTail_);
+    }
 
     void put(Key key, Value value) override;
     bool get(Key key, Value &value) override;
     Value get(Key key) override;
+    void putMany(const std::vector<std::pair<Key, Value>> &items) override;
+    size_t getMany(const std::vector<Key> &keys,
+                   std::vector<Value> &values,
+                   std::vector<bool> &found) override;
+
+    //带TTL的写入：条目在ttl之后过期，过期后get当作未命中。内存由
+    //访问时的惰性检查和每次操作顺手做的增量清扫回收，不需要定时
+    //线程扫全表刷新，也就不会污染LRU的访问顺序。
+    void putWithTtl(Key key, Value value, std::chrono::milliseconds ttl);
+
+    /**
+     * 异构查找版的get：Key是std::string而查找键还是请求缓冲区里的
+     * string_view切片时，直接拿切片探测，不为每次查找在堆上物化一个
+     * std::string，只有未命中之后要写入时才需要构造Key。命中路径和
+     * get完全一样（挪链表、记统计、进sketch）。要求K2和Key可比较
+     * 相等、std::hash对相同内容给相同值（string/string_view正是
+     * 如此）。模板成员没法做成虚函数，所以只在具体缓存类上提供。
+     */
+    template<typename K2>
+    bool get(const K2 &key, Value &value) {
+        bool hit = false;
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            reapStep();
+            hit = getInternal(key, value);
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+        return hit;
+    }
+
+    //只探测不访问：不动LRU序、不记统计、不进sketch，纯粹回答
+    //“在不在”。过期的条目当作不在，顺手回收。
+    template<typename K2>
+    bool contains(const K2 &key) {
+        bool exists = false;
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            NodePtr *found = nodeMap_.find(key);
+            if(found && (*found)->isExpired()) {
+                eraseNode(*found);
+                stats_.recordEviction();
+            }
+            else {
+                exists = found != nullptr;
+            }
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+        return exists;
+    }
+
+    //带预算hash的三个重载：分片包装器选分片时已经算过一次hash，
+    //这里直接传进来给索引探测用，省掉对长字符串key的第二次哈希。
+    //语义和不带hash的版本完全一致，hash必须是对key算出来的。
+    void put(Key key, Value value, size_t hash) {
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(capacity_ <= 0) return ;
+            reapStep();
+            putInternal(key, std::move(value), noExpire(), hash);
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+    }
+
+    template<typename K2>
+    bool get(const K2 &key, Value &value, size_t hash) {
+        bool hit = false;
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            reapStep();
+            hit = getInternal(key, value, hash);
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+        return hit;
+    }
+
+    template<typename K2>
+    bool contains(const K2 &key, size_t hash) {
+        bool exists = false;
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            NodePtr *found = nodeMap_.find(key, hash);
+            if(found && (*found)->isExpired()) {
+                eraseNode(*found);
+                stats_.recordEviction();
+            }
+            else {
+                exists = found != nullptr;
+            }
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+        return exists;
+    }
+
+    //就地构造value放入缓存，避免调用方先构造临时对象再拷一遍，
+    //value只在节点槽位里构造一次。模板成员没法做成虚函数，所以
+    //这个接口只在具体缓存类上提供。
+    template<typename... Args>
+    void emplace(const Key &key, Args&&... args) {
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(capacity_ <= 0) return ;
+            reapStep();
+            putInternal(key, Value(std::forward<Args>(args)...));
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+    }
+
+    //读取/清零内置统计。
+    CacheStatsSnapshot getStats() const { return stats_.snapshot(); }
+    void resetStats() { stats_.reset(); }
+    //字节预算模式下当前占用的字节数（按sizeOf_度量的value大小算）。
+    size_t currentBytes() const { return curBytes_; }
+
+    //当前条目数和容量，给分片包装器的再均衡当观测值用。计数是锁
+    //下的普通变量，读取也要拿锁——不然就是和写线程的数据竞争，
+    //不是什么“宽松读”。临界区只有一次读取，争用可以忽略。
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return nodeMap_.size();
+    }
+    size_t capacity() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return capacity_;
+    }
+
+    /**
+     * 运行时调整容量（分片再均衡用）：调小时立即从淘汰端裁到新
+     * 容量，被裁掉的条目照常走淘汰回调；调大时存量不动，后续写入
+     * 自然长上去。超出构造时预留的部分由节点池的堆后备和扁平表的
+     * 扩容兜底，功能不受影响，只是新增的那部分槽位享受不到池子。
+     */
+    void setCapacity(size_t capacity) {
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            capacity_ = capacity;
+            while(nodeMap_.size() > capacity_) {
+                evictOne();
+            }
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+    }
+
+    /**
+     * 原地清空：所有节点归还内存池、索引的槽位数组原地重置，没有
+     * 一次堆释放或分配，实例马上能装下一轮数据。主动失效不算淘汰，
+     * 不走淘汰回调、不记淘汰统计。
+     */
+    void clear() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        nodeMap_.forEach([this](const Key &, NodePtr node) {
+            nodePool_.release(node);
+        });
+        nodeMap_.clear();
+        dummyHead_->next_ = dummyTail_;
+        dummyTail_->prev_ = dummyHead_;
+        expiryQueue_.clear();
+        promotionBuffer_.clear();
+        curBytes_ = 0;
+    }
+
+    //删除单个key，在缓存里（包括已过期还没回收的）返回true。
+    //和clear一样是主动失效，不走淘汰回调。
+    bool erase(Key key) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        NodePtr *found = nodeMap_.find(key);
+        if(!found) return false;
+        eraseNode(*found, false);
+        return true;
+    }
+
+    /**
+     * 批量预热：一次加锁灌进整个区间，迭代器指向pair<Key, Value>。
+     * 节点池和索引在构造时已按容量建好，预热全程没有rehash也没有
+     * 堆分配，超出容量的部分照常从冷端淘汰。
+     */
+    template<typename It>
+    void bulkLoad(It first, It last) {
+        EvictionBatch evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(capacity_ <= 0) return ;
+            for(; first != last; ++first) {
+                putInternal(first->first, first->second);
+            }
+            evicted.swap(pendingEvictions_);
+        }
+        drainEvictions(evicted);
+    }
+
+    /**
+     * 快照持久化：把缓存内容按从冷到热的顺序写成紧凑的二进制文件，
+     * 重启后 restore 按同样顺序整批重放，LRU序和命中率几秒内回到
+     * 重启前的水平，不用再吃一轮冷启动的回源洪峰。TTL的截止时间是
+     * 进程本地的steady_clock，跨进程没有意义，所以不持久化：已过期
+     * 的条目写快照时直接跳过，没过期的恢复成不带TTL的条目。
+     */
+    bool snapshot(const std::string &path);
+    bool restore(const std::string &path);
+    //把本缓存的条目追加写进已打开的流，返回写出的条目数。给分片
+    //包装器把所有分片拼进一个文件用。
+    uint64_t appendSnapshot(std::ostream &out);
+    //恢复单条快照记录（restore 和分片包装器按hash路由后调用）。
+    void restoreEntry(uint32_t freq, Key key, Value value);
+
+    /**
+     * 注册淘汰回调：容量淘汰和过期回收的条目在销毁前把key和value
+     * move给回调，脏条目的写回不用再养一张影子表。淘汰在锁内只是把
+     * 条目挪进一个手递队列，回调由触发淘汰的线程在放锁之后调用：
+     * 写后端再慢也只拖慢自己这一次操作，别的线程照常拿锁。回调要在
+     * 开始用缓存之前注册好，不能和读写并发。
+     */
+    void setEvictionCallback(EvictionCallback cb) {
+        evictionCallback_ = std::move(cb);
+    }
+
+    /**
+     * 开启TinyLFU准入过滤：缓存满了之后，新key要和即将被淘汰的key
+     * 比估计频率，比不过就不准入，顶多在sketch里记一笔。循环扫描
+     * 这种一次性key再多也顶不掉常驻热点（testLoopPattern 那类负载
+     * 就不会再把缓存冲刷干净）。频率记在count-min sketch里，每个key
+     * 只占几个bit，不像 LruKCache 的 historyList_ 那样再养一个完整
+     * 的缓存。
+     */
+    void enableAdmissionFilter() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sketch_.reset(new FrequencySketch<Key>(capacity_));
+    }
+
+    /**
+     * 开启批量提升模式：命中路径不再当场做两次链表拼接（四个散落
+     * 节点的指针写，基本都是cache miss），而是把节点记进一个小缓冲，
+     * 攒满一批由当时拿着锁的线程统一落账。锁内的命中路径缩短成
+     * “探测表、拷value、追加一个指针”，拼接的开销摊到几十次命中上。
+     * 代价是两次落账之间的LRU序有最多一批的滞后——所有要挑牺牲者
+     * 的路径（淘汰、快照）都会先落账，刚访问过的节点不会被误伤，
+     * 命中率的差别只在批内的相对顺序，实测可以忽略。
+     */
+    void enableBatchedPromotion() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batchedPromotion_ = true;
+        promotionBuffer_.reserve(kPromotionBatchSize);
+    }
 
 private:
+    //不加锁的内部实现，供单个操作和批量操作共用。value按值传递，
+    //调用方传右值时一路move到节点里，全程零拷贝。getInternal 对
+    //查找键是模板的，异构版get直接复用同一条命中路径。带hash参数
+    //的版本给分片包装器用：选分片时算过的hash直接传进来，索引探测
+    //不再算第二次；不带的版本自己算一次，两边走同一条路径。
+    void putInternal(const Key &key, Value value, ExpireTime expireAt = noExpire()) {
+        putInternal(key, std::move(value), expireAt, TransparentHash{}(key));
+    }
+    void putInternal(const Key &key, Value value, ExpireTime expireAt, size_t hash);
+    template<typename K2>
+    bool getInternal(const K2 &key, Value &value) {
+        return getInternal(key, value, TransparentHash{}(key));
+    }
+    template<typename K2>
+    bool getInternal(const K2 &key, Value &value, size_t hash);
     void removeNode(NodePtr node);
     void insertNode(NodePtr node);
-    void addNewNode(const Key &key, const Value &value);
+    void addNewNode(const Key &key, Value value, ExpireTime expireAt, size_t hash);
+    void eraseNode(NodePtr node, bool notify = true);
+    void evictOne();
+    void reapStep();
+
+    //把缓冲里攒下的命中统一挪到表尾（锁内）。同一个节点被记了几次
+    //就挪几次，后一次只是原地搬回表尾，结果仍然正确。
+    void applyPromotions() {
+        for(NodePtr node : promotionBuffer_) {
+            removeNode(node);
+            insertNode(node);
+        }
+        promotionBuffer_.clear();
+    }
+
+    //锁外把这次操作攒下的淘汰条目交给回调。
+    void drainEvictions(EvictionBatch &batch) {
+        for(auto &entry : batch) {
+            evictionCallback_(std::move(entry.first), std::move(entry.second));
+        }
+        batch.clear();
+    }
 
 private:
     size_t capacity_;
+    //节点内存池，所有节点的内存都从这里拿，淘汰后槽位回收复用。
+    //注意要声明在节点指针之前，保证析构时节点先归还槽位。
+    NodePool<LruNodeType> nodePool_;
     //哈希表<key, Node>
     NodeMap nodeMap_;
-    //访问缓存要互斥
-    std::mutex mutex_;
+    //访问缓存要互斥。mutable：size()/capacity()这样的const观测
+    //也要在锁下读。
+    mutable std::mutex mutex_;
     //虚拟头节点和虚拟尾节点
     NodePtr dummyHead_;
     NodePtr dummyTail_;
+    //命中/未命中/淘汰计数
+    CacheStatistics stats_;
+
+    //====================TTL过期记录====================
+    //每次操作最多清扫多少条过期记录。
+    static const int kReapBatchSize = 8;
+    //带TTL的写入按插入顺序记在这条FIFO队列里，增量清扫从队头摘。
+    std::deque<std::pair<Key, ExpireTime>> expiryQueue_;
+
+    //====================字节预算====================
+    //字节上限，0表示只按条目数限容量。
+    size_t byteBudget_ = 0;
+    //当前占用的字节数。
+    size_t curBytes_ = 0;
+    //度量value大小的函数，只在字节预算模式下调用。
+    SizeFunc sizeOf_;
+
+    //TinyLFU准入过滤的频率sketch，空表示不开准入。
+    std::unique_ptr<FrequencySketch<Key>> sketch_;
+
+    //====================批量提升====================
+    //攒满这么多次命中才做一轮链表拼接。
+    static const size_t kPromotionBatchSize = 32;
+    //是否开启批量提升模式。
+    bool batchedPromotion_ = false;
+    //攒着还没挪位置的命中节点（锁内读写）。
+    std::vector<NodePtr> promotionBuffer_;
+
+    //====================淘汰回调====================
+    //空表示不关心淘汰。
+    EvictionCallback evictionCallback_;
+    //锁内攒、放锁后由同一线程清空的手递队列，只暂存当前这次操作
+    //淘汰的条目，长度天然有界。
+    EvictionBatch pendingEvictions_;
 };
 
 template<typename Key, typename Value>
@@ -94,55 +484,263 @@ void LruCache<Key, Value>::insertNode(NodePtr node) {
     dummyTail_->prev_ = node;
 }
 
+//把一个节点从缓存里整个摘掉：哈希表、链表、节点池各清一处。
+//批量提升模式下先把攒着的提升全部落账：一来缓冲里不能留下指向
+//已回收节点的指针，二来刚被访问过的节点落到表尾，不会被紧跟着
+//的淘汰误伤。
 template<typename Key, typename Value>
-void LruCache<Key, Value>::addNewNode(const Key &key, const Value &value) {
+void LruCache<Key, Value>::eraseNode(NodePtr node, bool notify) {
+    if(!promotionBuffer_.empty()) {
+        applyPromotions();
+    }
+    if(byteBudget_ > 0) {
+        curBytes_ -= sizeOf_(node->getValue());
+    }
+    nodeMap_.erase(node->getKey());
+    removeNode(node);
+    if(notify && evictionCallback_) {
+        //key和value直接从节点里move进手递队列，节点槽位照常回收。
+        pendingEvictions_.emplace_back(std::move(node->key_),
+                                       std::move(node->value_));
+    }
+    nodePool_.release(node);
+}
+
+//淘汰一个最近最少访问的节点，即头节点后面的节点。
+template<typename Key, typename Value>
+void LruCache<Key, Value>::evictOne() {
+    //挑牺牲者之前先把攒着的提升落账，免得把刚访问过的节点淘汰掉。
+    if(!promotionBuffer_.empty()) {
+        applyPromotions();
+    }
+    NodePtr victim = dummyHead_->next_;
+    if(victim == dummyTail_) return ;
+    eraseNode(victim);
+    stats_.recordEviction();
+}
+
+/**
+ * 增量清扫过期条目：过期记录按写入顺序排在FIFO队列里，每次操作顺手
+ * 从队头摘一小批已经到期的，不用扫 nodeMap_，单次操作的清扫工作量有
+ * 常数上界。条目被重新put过的话过期时间对不上，旧记录直接作废；各
+ * 条目TTL不一致时队头可能还没到期而后面的已经到期，这种条目留给访问
+ * 时的惰性检查兜底，队列只是尽快回收内存的快路径。
+ */
+template<typename Key, typename Value>
+void LruCache<Key, Value>::reapStep() {
+    if(expiryQueue_.empty()) return ;
+
+    ExpireTime now = CacheClock::now();
+    int budget = kReapBatchSize;
+    while(budget-- > 0 && !expiryQueue_.empty()) {
+        const auto &record = expiryQueue_.front();
+        if(record.second > now) break;
+        NodePtr *found = nodeMap_.find(record.first);
+        //条目可能已被淘汰或重新put过（过期时间对不上），记录作废。
+        if(found && (*found)->getExpireAt() == record.second) {
+            eraseNode(*found);
+            stats_.recordEviction();
+        }
+        expiryQueue_.pop_front();
+    }
+}
+
+template<typename Key, typename Value>
+void LruCache<Key, Value>::addNewNode(const Key &key, Value value, ExpireTime expireAt, size_t hash) {
+    //字节要在value被move走之前量好。
+    size_t bytes = byteBudget_ > 0 ? sizeOf_(value) : 0;
     if(nodeMap_.size() >= capacity_) {
-        //也要从哈希表中删除对应的键值对。
-        nodeMap_.erase(dummyHead_->next_->getKey());
-        //如果缓存已满，则先删除最近最少访问的节点，即链表节点。
-        removeNode(dummyHead_->next_);
+        //要挑牺牲者了，先把攒着的提升落账，链表序恢复精确。
+        if(!promotionBuffer_.empty()) {
+            applyPromotions();
+        }
+        if(sketch_) {
+            //准入过滤：新key的估计频率没超过即将被淘汰的key时不准入，
+            //常驻条目原地不动。这个key的这次访问已经记进sketch了，
+            //真热起来总会比过牺牲者。
+            NodePtr victim = dummyHead_->next_;
+            if(victim != dummyTail_ &&
+               sketch_->estimate(key) <= sketch_->estimate(victim->getKey())) {
+                return ;
+            }
+        }
+        //如果缓存已满，则先删除最近最少访问的节点，即头节点后面的节点。
+        //槽位归还给节点池，马上就会被新节点复用。
+        evictOne();
     }
-    //创建新节点，并插入到链尾。
-    NodePtr newNode = std::make_shared<LruNodeType>(key, value);
+    //从节点池中取槽位创建新节点，并插入到链尾。value被move进节点。
+    NodePtr newNode = nodePool_.acquire(key, std::move(value));
+    newNode->setExpireAt(expireAt);
     insertNode(newNode);
-    nodeMap_[key] = newNode;
+    nodeMap_.findOrInsert(key, hash) = newNode;
+    if(byteBudget_ > 0) {
+        curBytes_ += bytes;
+        //大value可能一次顶掉多个小条目，一直淘汰到回到预算之内。
+        //新节点在表尾，只有整个缓存都装不下它时才会淘汰到它自己。
+        while(curBytes_ > byteBudget_ && !nodeMap_.empty()) {
+            evictOne();
+        }
+    }
 }
 
 template<typename Key, typename Value>
-void LruCache<Key, Value>::put(Key key, Value value) {
-    if(capacity_ <= 0) return ;
-
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = nodeMap_.find(key);
-    if(it != nodeMap_.end()) {
+void LruCache<Key, Value>::putInternal(const Key &key, Value value, ExpireTime expireAt, size_t hash) {
+    stats_.recordPut();
+    if(sketch_) sketch_->recordAccess(key);
+    NodePtr *found = nodeMap_.find(key, hash);
+    if(found) {
+        NodePtr node = *found;
+        if(byteBudget_ > 0) {
+            //先加后减，避免无符号数中途下溢。
+            curBytes_ += sizeOf_(value);
+            curBytes_ -= sizeOf_(node->getValue());
+        }
         //如果已经存在这个节点，则更新它的value和将它移到表尾
-        it->second->setValue(value);
+        node->setValue(std::move(value));
+        //重新put会刷新过期时间（包括从有TTL改成没TTL）。
+        node->setExpireAt(expireAt);
         //将节点移到最新的位置
-        removeNode(it->second);
-        insertNode(it->second);
-        return ;
+        removeNode(node);
+        insertNode(node);
+        //value变大可能把缓存顶出预算。
+        while(byteBudget_ > 0 && curBytes_ > byteBudget_ && !nodeMap_.empty()) {
+            evictOne();
+        }
+    }
+    else {
+        //如果不存在这个节点，则创建它，并插入到最近访问的位置，即链尾。
+        addNewNode(key, std::move(value), expireAt, hash);
+    }
+    if(expireAt != noExpire()) {
+        expiryQueue_.emplace_back(key, expireAt);
     }
-    //如果不存在这个节点，则创建它，并插入到最近访问的位置，即链尾。
-    addNewNode(key, value);
 }
 
 template<typename Key, typename Value>
-bool LruCache<Key, Value>::get(Key key, Value &value) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = nodeMap_.find(key);
-    if(it != nodeMap_.end()) {
-        //如果找到了这个节点，则要更新它的位置，移到表尾。表示刚刚
-        //被访问过，所以应该排在表尾。
-        removeNode(it->second);
-        insertNode(it->second);
+template<typename K2>
+bool LruCache<Key, Value>::getInternal(const K2 &key, Value &value, size_t hash) {
+    //未命中的访问也要记，新key的频率就是靠这些未命中攒起来的。
+    if(sketch_) sketch_->recordAccess(key);
+    NodePtr *found = nodeMap_.find(key, hash);
+    if(found) {
+        NodePtr node = *found;
+        if(node->isExpired()) {
+            //过期的条目不算命中，顺手把它回收掉。
+            eraseNode(node);
+            stats_.recordEviction();
+            stats_.recordMiss();
+            return false;
+        }
+        if(batchedPromotion_) {
+            //批量提升模式：命中只把节点记进缓冲，链表不动。攒够一批
+            //再统一挪位置，四次指针写和随之而来的cache miss摊薄到几十
+            //次命中上，锁的持有时间短得多。
+            promotionBuffer_.push_back(node);
+            if(promotionBuffer_.size() >= kPromotionBatchSize) {
+                applyPromotions();
+            }
+        }
+        else {
+            //如果找到了这个节点，则要更新它的位置，移到表尾。表示刚刚
+            //被访问过，所以应该排在表尾。
+            removeNode(node);
+            insertNode(node);
+        }
         //返回它的value。
-        value = it->second->getValue();
+        value = node->getValue();
+        stats_.recordHit();
         return true;
     }
     //没有找到。
+    stats_.recordMiss();
     return false;
 }
 
+template<typename Key, typename Value>
+void LruCache<Key, Value>::put(Key key, Value value) {
+    EvictionBatch evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        //capacity_会被setCapacity并发改动，判空也要在锁下。
+        if(capacity_ <= 0) return ;
+        //顺手清扫一小批过期条目。
+        reapStep();
+        putInternal(key, std::move(value));
+        evicted.swap(pendingEvictions_);
+    }
+    //淘汰回调在锁外调用，慢的写回不挡别的线程。
+    drainEvictions(evicted);
+}
+
+template<typename Key, typename Value>
+void LruCache<Key, Value>::putWithTtl(Key key, Value value, std::chrono::milliseconds ttl) {
+    EvictionBatch evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(capacity_ <= 0) return ;
+        reapStep();
+        putInternal(key, std::move(value), CacheClock::now() + ttl);
+        evicted.swap(pendingEvictions_);
+    }
+    drainEvictions(evicted);
+}
+
+template<typename Key, typename Value>
+bool LruCache<Key, Value>::get(Key key, Value &value) {
+    bool hit = false;
+    EvictionBatch evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        //顺手清扫一小批过期条目。
+        reapStep();
+        hit = getInternal(key, value);
+        evicted.swap(pendingEvictions_);
+    }
+    drainEvictions(evicted);
+    return hit;
+}
+
+//批量写：整批只加一次锁，省掉 N-1 次锁的往返。
+template<typename Key, typename Value>
+void LruCache<Key, Value>::putMany(const std::vector<std::pair<Key, Value>> &items) {
+    EvictionBatch evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(capacity_ <= 0) return ;
+        reapStep();
+        for(const auto &item : items) {
+            putInternal(item.first, item.second);
+        }
+        evicted.swap(pendingEvictions_);
+    }
+    drainEvictions(evicted);
+}
+
+//批量读：整批只加一次锁。
+template<typename Key, typename Value>
+size_t LruCache<Key, Value>::getMany(const std::vector<Key> &keys,
+                                     std::vector<Value> &values,
+                                     std::vector<bool> &found) {
+    values.assign(keys.size(), Value{});
+    found.assign(keys.size(), false);
+    size_t hitCount = 0;
+
+    EvictionBatch evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reapStep();
+        for(size_t i = 0; i < keys.size(); ++i) {
+            if(getInternal(keys[i], values[i])) {
+                found[i] = true;
+                ++hitCount;
+            }
+        }
+        evicted.swap(pendingEvictions_);
+    }
+    drainEvictions(evicted);
+    return hitCount;
+}
+
 template<typename Key, typename Value>
 Value LruCache<Key, Value>::get(Key key) {
     Value value{};
@@ -150,96 +748,428 @@ Value LruCache<Key, Value>::get(Key key) {
     return value;
 }
 
+//从冷端到热端写，恢复时按同样顺序重放就还原了LRU序。整个写出在
+//锁内一口气完成：都是顺序IO，十万条目也只是几十毫秒的停顿。
+template<typename Key, typename Value>
+uint64_t LruCache<Key, Value>::appendSnapshot(std::ostream &out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    //快照按链表序写，先把攒着的提升落账，写出去的才是精确的LRU序。
+    if(!promotionBuffer_.empty()) {
+        applyPromotions();
+    }
+    uint64_t count = 0;
+    for(NodePtr node = dummyHead_->next_; node != dummyTail_; node = node->next_) {
+        //过期的条目不值得带进下一个进程。
+        if(node->isExpired()) continue;
+        uint32_t freq = static_cast<uint32_t>(node->getAccessCount());
+        if(!snapshotWrite(out, freq) || !snapshotWrite(out, node->getKey())
+           || !snapshotWrite(out, node->getValue())) {
+            break;
+        }
+        ++count;
+    }
+    return count;
+}
+
+template<typename Key, typename Value>
+bool LruCache<Key, Value>::snapshot(const std::string &path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if(!out) return false;
+    //条目数先占位，记录写完再回头补上。
+    if(!snapshotWriteHeader(out, 0)) return false;
+    uint64_t count = appendSnapshot(out);
+    return snapshotPatchCount(out, count);
+}
+
+template<typename Key, typename Value>
+void LruCache<Key, Value>::restoreEntry(uint32_t freq, Key key, Value value) {
+    EvictionBatch evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(capacity_ <= 0) return ;
+        putInternal(key, std::move(value));
+        //访问计数也还原回去。
+        NodePtr *found = nodeMap_.find(key);
+        if(found) (*found)->accessCount_ = freq;
+        evicted.swap(pendingEvictions_);
+    }
+    drainEvictions(evicted);
+}
+
+template<typename Key, typename Value>
+bool LruCache<Key, Value>::restore(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if(!in) return false;
+    uint64_t count = 0;
+    if(!snapshotReadHeader(in, count)) return false;
+    for(uint64_t i = 0; i < count; ++i) {
+        uint32_t freq = 0;
+        Key key{};
+        Value value{};
+        if(!snapshotRead(in, freq) || !snapshotRead(in, key)
+           || !snapshotRead(in, value)) {
+            return false;
+        }
+        restoreEntry(freq, std::move(key), std::move(value));
+    }
+    return true;
+}
+
 //==================================LRUK==========================================
 
-//LRU优化：LRU-K 版本，通过继承的方法进行再优化。
-//这个派生类多了一个历史缓存，只有当访问次数超过 k 次时才会进入 LRU 
-//的缓冲中。
+template<typename Key, typename Value> class LruKCache;
+
+/**
+ * LRU-K 的节点：一把索引管两条链，节点自己带访问计数和所在链的
+ * 标记。key不管在历史链还是缓存链上都只有这一个节点、一条索引项，
+ * 操作不需要在两个缓存之间来回倒。
+ */
 template<typename Key, typename Value>
-class LruKCache : public LruCache<Key, Value> {
+class LruKNode {
 public:
-    LruKCache(int capacity, int historyCapacity, int k)
-                : LruCache<Key, Value>(capacity)
-                , historyList_(std::make_unique<LruCache<Key, size_t>>(historyCapacity))
-                , k_(k) {}
+    friend class LruKCache<Key, Value>;
+
+    LruKNode() : count_(0), cached_(false), prev_(nullptr), next_(nullptr) {}
+    LruKNode(Key key, Value value)
+            : key_(std::move(key))
+            , value_(std::move(value))
+            , count_(1)
+            , cached_(false)
+            , prev_(nullptr)
+            , next_(nullptr) {}
+
+    Key getKey() const { return key_; }
+    const Value &getValue() const { return value_; }
+    void setValue(const Value &value) { value_ = value; }
+    void setValue(Value &&value) { value_ = std::move(value); }
+
+private:
+    Key key_;
+    Value value_;
+    //累计访问次数，达到k次后从历史链晋升到缓存链。
+    size_t count_;
+    //true表示在缓存链上，false表示还在历史链上考察。
+    bool cached_;
+    LruKNode *prev_;
+    LruKNode *next_;
+};
 
-    void put(Key key, Value value) {
+/**
+ * LRU-K：访问满k次才真正进缓存，一次性访问的key只在历史链上走一遭，
+ * 冲刷不掉常驻数据。
+ *
+ * 老版本用继承拼出来：主缓存和历史缓存各是一个完整的带锁LruCache，
+ * 一次put最多五次加锁、五次哈希查找。这版是独立实现：一张key到节点
+ * 的索引，节点自带访问计数和“历史/缓存”标记，历史链和缓存链都是
+ * 侵入式双向链表。任何操作都是一次加锁加一次哈希查找，剩下的全是
+ * O(1)的链表指针操作。
+ *
+ * 历史链上的节点把put进来的value也带着，晋升时直接把节点挪到缓存
+ * 链，不用调用方再put一次。
+ */
+template<typename Key, typename Value>
+class LruKCache : public CachePolicy<Key, Value> {
+public:
+    using NodeType = LruKNode<Key, Value>;
+    using NodePtr = NodeType*;
+    using NodeMap = FlatHashMap<Key, NodePtr>;
+
+    //节点池容纳缓存链+历史链的全部节点，外加四个虚拟头尾。
+    LruKCache(size_t capacity, size_t historyCapacity, size_t k)
+            : capacity_(capacity)
+            , historyCapacity_(historyCapacity)
+            , k_(k)
+            , cachedSize_(0)
+            , historySize_(0)
+            , nodePool_(capacity + historyCapacity + 4)
+            , nodeMap_(capacity + historyCapacity) {
+        cacheHead_ = nodePool_.acquire();
+        cacheTail_ = nodePool_.acquire();
+        cacheHead_->next_ = cacheTail_;
+        cacheTail_->prev_ = cacheHead_;
+        historyHead_ = nodePool_.acquire();
+        historyTail_ = nodePool_.acquire();
+        historyHead_->next_ = historyTail_;
+        historyTail_->prev_ = historyHead_;
+    }
+
+    ~LruKCache() override {
+        //singleflight的写回线程先join，再拆缓存自己的状态。
+        this->flight_.shutdown();
+        nodeMap_.forEach([this](const Key &, NodePtr node) {
+            nodePool_.release(node);
+        });
+        nodePool_.release(cacheHead_);
+        nodePool_.release(cacheTail_);
+        nodePool_.release(historyHead_);
+        nodePool_.release(historyTail_);
+    }
+
+    void put(Key key, Value value) override {
+        if(capacity_ == 0) return ;
 
-        Value tempValue;
-        if(LruCache<Key, Value>::get(key, tempValue)) {
-            //如果已经在缓存中（不是在历史缓存），则直接覆盖更新数据
-            LruCache<Key, Value>::put(key, value);
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.recordPut();
+        NodePtr *found = nodeMap_.find(key);
+        if(!found) {
+            //第一次见到：进历史链考察（k<=1时直接进缓存链）。
+            addNewNode(key, std::move(value));
             return ;
         }
-        
-        int historyCount;
-        //不在缓存中，则加入到历史缓存中
-        //historyList_ 的 value 是访问次数
-        if(!(historyList_->get(key, historyCount))) {
-            //不在历史缓存中，则访问次数为0
-            historyCount = 0;
-        }
-        //放入历史缓存中。
-        historyList_->put(key, ++historyCount);
-
-        //判断是否要进入缓存中
-        if(historyCount >= k_) {
-            //先从历史缓存中移除
-            historyList_->removeNode(historyList_->nodeMap_[key]);
-            //再加入到 LRU 缓存中
-            LruCache<Key, Value>::put(key, value);
-        }
-    }
-    
-    // bool get(Key key, Value &value) {
-        
-    // }
 
-    Value get(Key key) {
-        //调用父类LRU的 get 方法获取历史缓存对应key的值，它的值就是
-        //访问次数。
-        int historyCount = historyList_->get(key);
-        //历史缓存是按照LRU的规则进行淘汰的，所以对历史缓存的操作直接用
-        //父类 LRU 的方法即可。
-        //如果访问到数据，则更新历史访问记录节点值count++
-        historyList_->put(key, ++historyCount);
+        NodePtr node = *found;
+        node->setValue(std::move(value));
+        ++node->count_;
+        if(node->cached_) {
+            //已经在缓存链上，挪到最近访问端。
+            moveToTail(node, cacheTail_);
+        }
+        else if(node->count_ >= k_) {
+            promote(node);
+        }
+        else {
+            moveToTail(node, historyTail_);
+        }
+    }
+
+    bool get(Key key, Value &value) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        NodePtr *found = nodeMap_.find(key);
+        if(!found) {
+            stats_.recordMiss();
+            return false;
+        }
+
+        NodePtr node = *found;
+        ++node->count_;
+        if(node->cached_) {
+            moveToTail(node, cacheTail_);
+            value = node->getValue();
+            stats_.recordHit();
+            return true;
+        }
+        //还在历史链上：计数攒够了就晋升，晋升后这次访问算命中
+        //（历史节点带着上次put的value）。
+        if(node->count_ >= k_) {
+            promote(node);
+            value = node->getValue();
+            stats_.recordHit();
+            return true;
+        }
+        moveToTail(node, historyTail_);
+        stats_.recordMiss();
+        return false;
+    }
+
+    Value get(Key key) override {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    //读取/清零内置统计。
+    CacheStatsSnapshot getStats() const { return stats_.snapshot(); }
+    void resetStats() { stats_.reset(); }
+
+    //原地清空：两条链的节点全部归还内存池，索引槽位数组原地重置。
+    void clear() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        nodeMap_.forEach([this](const Key &, NodePtr node) {
+            nodePool_.release(node);
+        });
+        nodeMap_.clear();
+        cacheHead_->next_ = cacheTail_;
+        cacheTail_->prev_ = cacheHead_;
+        historyHead_->next_ = historyTail_;
+        historyTail_->prev_ = historyHead_;
+        cachedSize_ = 0;
+        historySize_ = 0;
+    }
+
+    //删除单个key，不管它在缓存链还是还在历史链上考察。
+    bool erase(Key key) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        NodePtr *found = nodeMap_.find(key);
+        if(!found) return false;
+        NodePtr node = *found;
+        if(node->cached_) --cachedSize_;
+        else --historySize_;
+        nodeMap_.erase(node->getKey());
+        unlink(node);
+        nodePool_.release(node);
+        return true;
+    }
+
+private:
+    void unlink(NodePtr node) {
+        node->prev_->next_ = node->next_;
+        node->next_->prev_ = node->prev_;
+    }
+
+    //插到指定链的表尾（最近访问端）。
+    void moveToTail(NodePtr node, NodePtr tail) {
+        unlink(node);
+        insertBefore(node, tail);
+    }
+
+    void insertBefore(NodePtr node, NodePtr tail) {
+        node->next_ = tail;
+        node->prev_ = tail->prev_;
+        tail->prev_->next_ = node;
+        tail->prev_ = node;
+    }
+
+    //淘汰指定链表头的节点（最久未访问的）。
+    void evictFront(NodePtr head) {
+        NodePtr victim = head->next_;
+        nodeMap_.erase(victim->getKey());
+        unlink(victim);
+        nodePool_.release(victim);
+    }
+
+    //历史链节点晋升到缓存链：只挪链表指针，索引项不动。
+    void promote(NodePtr node) {
+        unlink(node);
+        --historySize_;
+        if(cachedSize_ >= capacity_) {
+            evictFront(cacheHead_);
+            --cachedSize_;
+            stats_.recordEviction();
+        }
+        node->cached_ = true;
+        insertBefore(node, cacheTail_);
+        ++cachedSize_;
+    }
 
-        return LruCache<Key, Value>::get(key);
+    void addNewNode(const Key &key, Value value) {
+        if(k_ <= 1) {
+            //k为1就是普通LRU，直接进缓存链。
+            if(cachedSize_ >= capacity_) {
+                evictFront(cacheHead_);
+                --cachedSize_;
+                stats_.recordEviction();
+            }
+            NodePtr node = nodePool_.acquire(key, std::move(value));
+            node->cached_ = true;
+            nodeMap_[key] = node;
+            insertBefore(node, cacheTail_);
+            ++cachedSize_;
+            return ;
+        }
+        if(historySize_ >= historyCapacity_) {
+            //历史链满了，淘汰考察中最久未访问的key。
+            evictFront(historyHead_);
+            --historySize_;
+        }
+        NodePtr node = nodePool_.acquire(key, std::move(value));
+        nodeMap_[key] = node;
+        insertBefore(node, historyTail_);
+        ++historySize_;
     }
 
 private:
-    //进入缓存队列的评判标准
-    int k_;
-    //historyList_ 也是 LRU 缓存，不过它的 value 是访问次数。
-    std::unique_ptr<LruCache<Key, size_t>> historyList_;
+    size_t capacity_;
+    size_t historyCapacity_;
+    //晋升到缓存链的访问次数门槛
+    size_t k_;
+    //两条链各自的长度
+    size_t cachedSize_;
+    size_t historySize_;
+    std::mutex mutex_;
+    //节点内存池，两条链的节点都从这里拿。
+    NodePool<NodeType> nodePool_;
+    //唯一的key到节点索引，历史链和缓存链共用。
+    NodeMap nodeMap_;
+    //缓存链的虚拟头尾（表尾是最近访问端）
+    NodePtr cacheHead_;
+    NodePtr cacheTail_;
+    //历史链的虚拟头尾
+    NodePtr historyHead_;
+    NodePtr historyTail_;
+    //命中/未命中/淘汰计数
+    CacheStatistics stats_;
 };
 
+
 //LRU优化：对LRU进行分片，提高并发使用的性能
 template<typename Key, typename Value>
 class HashLruCaches : public CachePolicy<Key, Value>{
 public:
-    //hardware_concurrenty这个函数将返回能同时并发在一个程序中的线程数量
+    //hardware_concurrenty这个函数将返回能同时并发在一个程序中的线程数量。
+    //分片数向上取整到2的幂，选分片时用位与代替整数取模（取模是几十个
+    //周期的除法指令，位与只要一个周期）。
     HashLruCaches(size_t capacity, int sliceNum = std::thread::hardware_concurrency())
                     : capacity_(capacity)
-                    , sliceNum_(sliceNum) {
+                    , sliceNum_(roundUpPow2(sliceNum))
+                    , sliceMask_(sliceNum_ - 1) {
         
-        //获取每个分片的大小
+        //获取每个分片的大小。均分只是起点：分片数决定的是锁的粒度，
+        //每个分片的容量份额后续可以由 rebalance 按需挪动。
         size_t sliceSize = std::ceil(capacity / static_cast<double>(sliceNum_));
         for (int i = 0; i < sliceNum_; ++i) {
             //将创建的每个分片缓存放入lruSliceCaches_中
             lruSliceCaches_.emplace_back(new LruCache<Key, Value>(sliceSize));
         }
+        lastEvictions_.assign(sliceNum_, 0);
+    }
+
+    /**
+     * NUMA交错构造：每个分片在自己的一条绑核线程上构造，分片的
+     * arena和索引槽位数组借助first-touch铺到各个NUMA节点，而不是
+     * 全部落在构造者所在的节点（见 CacheNuma.h）。分片选择仍然是
+     * key的hash低位——路由保持确定性，任何线程都能查到任何key，
+     * 省掉的是命中后摸节点内存的那些跨节点访问。
+     */
+    HashLruCaches(NumaInterleaved, size_t capacity,
+                  int sliceNum = std::thread::hardware_concurrency())
+                    : capacity_(capacity)
+                    , sliceNum_(roundUpPow2(sliceNum))
+                    , sliceMask_(sliceNum_ - 1) {
+
+        size_t sliceSize = std::ceil(capacity / static_cast<double>(sliceNum_));
+        lruSliceCaches_.resize(sliceNum_);
+        constructShardsInterleaved(sliceNum_, [this, sliceSize](size_t i) {
+            lruSliceCaches_[i].reset(new LruCache<Key, Value>(sliceSize));
+        });
+        lastEvictions_.assign(sliceNum_, 0);
+    }
+
+    //字节预算模式：条目数和字节预算都按分片数均分，每个分片独立
+    //在自己的份额内淘汰。
+    HashLruCaches(size_t capacity, size_t byteBudget,
+                  typename LruCache<Key, Value>::SizeFunc sizeOf,
+                  int sliceNum = std::thread::hardware_concurrency())
+                    : capacity_(capacity)
+                    , sliceNum_(roundUpPow2(sliceNum))
+                    , sliceMask_(sliceNum_ - 1) {
+
+        size_t sliceSize = std::ceil(capacity / static_cast<double>(sliceNum_));
+        size_t sliceBudget = std::ceil(byteBudget / static_cast<double>(sliceNum_));
+        for (int i = 0; i < sliceNum_; ++i) {
+            lruSliceCaches_.emplace_back(
+                new LruCache<Key, Value>(sliceSize, sliceBudget, sizeOf));
+        }
+        lastEvictions_.assign(sliceNum_, 0);
     }
 
+    //getOrLoad转发给分片，自己的在途表正常情况下是空的；这里的
+    //shutdown是兜底，真正的加载线程由各分片析构时自己join。
+    ~HashLruCaches() override { this->flight_.shutdown(); }
+
     void put(Key key, Value value) override {
-        //根据key的hash值，将key分配到对应的分片缓存中
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        return lruSliceCaches_[sliceIndex]->put(key, value);
+        //根据key的hash值，将key分配到对应的分片缓存中。key的hash
+        //在这里只算一次，分片用低位掩码选，再把同一个hash传给分片
+        //做索引探测（分片内的扁平表会把hash再搅一遍，低位相同的key
+        //在分片内仍然能散开）。
+        size_t hash = Hash(key);
+        size_t sliceIndex = hash & sliceMask_;
+        return lruSliceCaches_[sliceIndex]->put(key, value, hash);
     }
 
     bool get(Key key, Value &value) override {
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        return lruSliceCaches_[sliceIndex]->get(key, value);
+        size_t hash = Hash(key);
+        size_t sliceIndex = hash & sliceMask_;
+        return lruSliceCaches_[sliceIndex]->get(key, value, hash);
     }
 
     Value get(Key key) override {
@@ -249,19 +1179,277 @@ public:
         return value;
     }
 
+    //异构查找版的get/contains：选分片和分片内的探测都直接用原始的
+    //key切片，整条查找路径不物化Key，hash也只算这一次。
+    template<typename K2>
+    bool get(const K2 &key, Value &value) {
+        size_t hash = Hash(key);
+        size_t sliceIndex = hash & sliceMask_;
+        return lruSliceCaches_[sliceIndex]->get(key, value, hash);
+    }
+
+    template<typename K2>
+    bool contains(const K2 &key) {
+        size_t hash = Hash(key);
+        size_t sliceIndex = hash & sliceMask_;
+        return lruSliceCaches_[sliceIndex]->contains(key, hash);
+    }
+
+    //批量写：先按分片分组，每个分片整批写入，分片锁各拿一次。
+    void putMany(const std::vector<std::pair<Key, Value>> &items) override {
+        std::vector<std::vector<std::pair<Key, Value>>> sliceItems(sliceNum_);
+        for(const auto &item : items) {
+            sliceItems[Hash(item.first) & sliceMask_].push_back(item);
+        }
+        for(int i = 0; i < sliceNum_; ++i) {
+            if(!sliceItems[i].empty()) {
+                lruSliceCaches_[i]->putMany(sliceItems[i]);
+            }
+        }
+    }
+
+    //批量读：按分片分组查询，再按原顺序把结果散列回去。
+    size_t getMany(const std::vector<Key> &keys,
+                   std::vector<Value> &values,
+                   std::vector<bool> &found) override {
+        values.assign(keys.size(), Value{});
+        found.assign(keys.size(), false);
+
+        //每个分片要查的key以及它们在原批次中的下标。
+        std::vector<std::vector<Key>> sliceKeys(sliceNum_);
+        std::vector<std::vector<size_t>> sliceIndexes(sliceNum_);
+        for(size_t i = 0; i < keys.size(); ++i) {
+            size_t sliceIndex = Hash(keys[i]) & sliceMask_;
+            sliceKeys[sliceIndex].push_back(keys[i]);
+            sliceIndexes[sliceIndex].push_back(i);
+        }
+
+        size_t hitCount = 0;
+        std::vector<Value> sliceValues;
+        std::vector<bool> sliceFound;
+        for(int s = 0; s < sliceNum_; ++s) {
+            if(sliceKeys[s].empty()) continue;
+            hitCount += lruSliceCaches_[s]->getMany(sliceKeys[s], sliceValues, sliceFound);
+            for(size_t j = 0; j < sliceKeys[s].size(); ++j) {
+                if(sliceFound[j]) {
+                    values[sliceIndexes[s][j]] = sliceValues[j];
+                    found[sliceIndexes[s][j]] = true;
+                }
+            }
+        }
+        return hitCount;
+    }
+
+    //每个分片开启自己的TinyLFU准入过滤（sketch按分片容量建）。
+    void enableAdmissionFilter() {
+        for(auto &cache : lruSliceCaches_) {
+            cache->enableAdmissionFilter();
+        }
+    }
+
+    //每个分片开启批量提升：分片摊薄的是锁的争抢次数，批量提升缩短
+    //的是每次命中握着锁的时间，两个正交的优化叠着用。
+    void enableBatchedPromotion() {
+        for(auto &cache : lruSliceCaches_) {
+            cache->enableBatchedPromotion();
+        }
+    }
+
+    //逐个分片原地清空，分片锁挨个拿，不需要停全局的流量，也没有
+    //销毁重建实例的那场分配风暴。
+    void clear() override {
+        for(auto &cache : lruSliceCaches_) {
+            cache->clear();
+        }
+    }
+
+    bool erase(Key key) override {
+        return lruSliceCaches_[Hash(key) & sliceMask_]->erase(key);
+    }
+
+    //批量预热：按分片分组后整组灌进对应分片，每个分片的锁只拿一次。
+    template<typename It>
+    void bulkLoad(It first, It last) {
+        std::vector<std::vector<std::pair<Key, Value>>> sliceItems(sliceNum_);
+        for(; first != last; ++first) {
+            sliceItems[Hash(first->first) & sliceMask_].emplace_back(
+                first->first, first->second);
+        }
+        for(int i = 0; i < sliceNum_; ++i) {
+            if(!sliceItems[i].empty()) {
+                lruSliceCaches_[i]->bulkLoad(sliceItems[i].begin(),
+                                             sliceItems[i].end());
+            }
+        }
+    }
+
+    //每个分片注册同一个淘汰回调，各分片在自己的锁外交付。
+    void setEvictionCallback(typename LruCache<Key, Value>::EvictionCallback cb) {
+        for(auto &cache : lruSliceCaches_) {
+            cache->setEvictionCallback(cb);
+        }
+    }
+
+    /**
+     * 按淘汰压力再均衡各分片的容量份额。分片数是按核数定的锁粒度，
+     * 可key的hash分布未必均匀：总有分片被打满、在100%占用下反复
+     * 淘汰热数据，同时别的分片半空着。这里把两件事解耦——锁还是
+     * 那些锁，容量份额按需流动：
+     *
+     * 每个分片的需求权重 = 当前占用 + 上次再均衡以来的淘汰数（占用
+     * 说明装了多少，淘汰数说明还想装多少装不下），总预算按权重比例
+     * 重新切分。每个分片保底拿均分值的1/4，冷分片突然变热时有起步
+     * 空间，不会被饿死在保底以下。先收缩后扩张，过程中的总份额不会
+     * 超过预算。
+     *
+     * 由调用方定期调用（比如维护线程每几秒一次），和正常读写并发
+     * 是安全的（每个分片的容量调整在各自的锁内做）；多个线程并发
+     * 调rebalance本身没有意义，不支持。
+     */
+    void rebalance() {
+        size_t n = lruSliceCaches_.size();
+        if(n <= 1 || capacity_ == 0) return ;
+
+        //观测：占用 + 这一轮新增的淘汰数。
+        std::vector<uint64_t> weight(n);
+        uint64_t totalWeight = 0;
+        for(size_t i = 0; i < n; ++i) {
+            uint64_t evictions = lruSliceCaches_[i]->getStats().evictions;
+            weight[i] = lruSliceCaches_[i]->size()
+                        + (evictions - lastEvictions_[i]);
+            lastEvictions_[i] = evictions;
+            totalWeight += weight[i];
+        }
+
+        //保底份额之外的预算按权重比例分，余数给权重最大的分片。
+        size_t fairShare = std::max<size_t>(capacity_ / n, 1);
+        size_t floorShare = std::max<size_t>(fairShare / 4, 1);
+        size_t spare = capacity_ > floorShare * n ? capacity_ - floorShare * n : 0;
+
+        std::vector<size_t> target(n, floorShare);
+        if(totalWeight == 0) {
+            //一片安静，回到均分。
+            target.assign(n, fairShare);
+        }
+        else {
+            size_t assigned = 0;
+            size_t hottest = 0;
+            for(size_t i = 0; i < n; ++i) {
+                size_t extra = spare * weight[i] / totalWeight;
+                target[i] += extra;
+                assigned += extra;
+                if(weight[i] > weight[hottest]) hottest = i;
+            }
+            target[hottest] += spare - assigned;
+        }
+
+        //先收缩后扩张，避免过程中总份额超出预算。
+        for(size_t i = 0; i < n; ++i) {
+            if(target[i] < lruSliceCaches_[i]->capacity()) {
+                lruSliceCaches_[i]->setCapacity(target[i]);
+            }
+        }
+        for(size_t i = 0; i < n; ++i) {
+            if(target[i] > lruSliceCaches_[i]->capacity()) {
+                lruSliceCaches_[i]->setCapacity(target[i]);
+            }
+        }
+    }
+
+    //快照/恢复：所有分片拼成一个文件，分片锁挨个拿，写快照不用
+    //停全局的流量。恢复时按key的hash重新路由，重启后分片数变了
+    //照样能加载。
+    bool snapshot(const std::string &path) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if(!out) return false;
+        if(!snapshotWriteHeader(out, 0)) return false;
+        uint64_t count = 0;
+        for(auto &cache : lruSliceCaches_) {
+            count += cache->appendSnapshot(out);
+        }
+        return snapshotPatchCount(out, count);
+    }
+
+    bool restore(const std::string &path) {
+        std::ifstream in(path, std::ios::binary);
+        if(!in) return false;
+        uint64_t count = 0;
+        if(!snapshotReadHeader(in, count)) return false;
+        for(uint64_t i = 0; i < count; ++i) {
+            uint32_t freq = 0;
+            Key key{};
+            Value value{};
+            if(!snapshotRead(in, freq) || !snapshotRead(in, key)
+               || !snapshotRead(in, value)) {
+                return false;
+            }
+            size_t sliceIndex = Hash(key) & sliceMask_;
+            lruSliceCaches_[sliceIndex]->restoreEntry(freq, std::move(key),
+                                                      std::move(value));
+        }
+        return true;
+    }
+
+    //读穿透转发给对应的分片，让singleflight的在途表按分片拆开，
+    //不同分片的回源互不抢锁。
+    Value getOrLoad(Key key, const typename CachePolicy<Key, Value>::Loader &loader) override {
+        return lruSliceCaches_[Hash(key) & sliceMask_]->getOrLoad(key, loader);
+    }
+
+    std::shared_future<Value> getOrLoadAsync(Key key,
+            const typename CachePolicy<Key, Value>::Loader &loader) override {
+        return lruSliceCaches_[Hash(key) & sliceMask_]->getOrLoadAsync(key, loader);
+    }
+
+    //聚合所有分片的统计。
+    CacheStatsSnapshot getStats() const {
+        CacheStatsSnapshot total;
+        for(const auto &cache : lruSliceCaches_) {
+            total += cache->getStats();
+        }
+        return total;
+    }
+
+    //逐分片的统计，下标就是分片号：某个分片的淘汰/未命中远高于
+    //其他分片就是热分片，可以喂给 rebalance 或者直接报警。
+    std::vector<CacheStatsSnapshot> getSliceStats() const {
+        std::vector<CacheStatsSnapshot> stats;
+        stats.reserve(lruSliceCaches_.size());
+        for(const auto &cache : lruSliceCaches_) {
+            stats.push_back(cache->getStats());
+        }
+        return stats;
+    }
+
 private:
-    size_t Hash(Key key) {
-        std::hash<Key> hashFunc;
-        return hashFunc(key);
+    //对查找键的类型做哈希：string_view 之类的异构key不用先物化成
+    //Key就能选分片。必须和分片内索引用同一个 TransparentHash——
+    //它对 const char* 按内容哈希，std::hash<const char*> 却是按指针
+    //哈希，两边不一致的话查找会被路由到随机的分片上，明明在缓存里
+    //的key也查不到。
+    template<typename K2>
+    size_t Hash(const K2 &key) {
+        return TransparentHash{}(key);
+    }
+
+    //把分片数向上取整到2的幂。
+    static int roundUpPow2(int n) {
+        int p = 1;
+        while(p < n) p <<= 1;
+        return p;
     }
 
 private:
     size_t capacity_;
-    //切片数量
+    //切片数量（2的幂）
     int sliceNum_;
+    //选分片用的掩码，等于 sliceNum_ - 1。
+    size_t sliceMask_;
     //切片LRU缓存
     //每个元素都是一个指向LRU缓存的unique_ptr指针
     std::vector<std::unique_ptr<LruCache<Key, Value>>> lruSliceCaches_;
+    //上次 rebalance 时各分片的累计淘汰数，差值就是本轮的淘汰压力。
+    std::vector<uint64_t> lastEvictions_;
 };
 
 }// namespace Cache
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <new>
+#include <utility>
+
+namespace Cache {
+
+/**
+ * 节点内存池（arena）：在构造时按容量一次性预分配一块连续内存，
+ * 节点被淘汰后槽位通过空闲链表回收复用，稳态下 put/get 不再向
+ * 堆申请内存，避免长时间运行后的堆碎片问题。
+ *
+ * 节点的生命周期完全由缓存自己管理：acquire 在槽位上就地构造
+ * 节点并返回裸指针，release 析构节点并把槽位挂回空闲链表。
+ * 池子耗尽（比如 ARC 动态扩容超过预留量）时退回到堆分配，保证
+ * 功能正确，只是这部分节点享受不到池子的好处。
+ *
+ * 空闲链表自己带一把小锁：单锁的缓存里它是锁内的无争用开销，而
+ * ARC 的两个部分各持自己的锁却共享同一个池子，acquire/release
+ * 可能从两把不同的锁下并发进来，空闲链表必须自己保证互斥。节点
+ * 的构造和析构都放在锁外做，临界区只有一次 push/pop。
+ */
+template<typename Node>
+class NodePool {
+public:
+    explicit NodePool(size_t capacity)
+                : capacity_(capacity)
+                , block_(new unsigned char[sizeof(Node) * capacity]) {
+        //把整块arena先写一遍：NUMA上页归第一个写它的线程所在的节点
+        //（first-touch），在构造线程上摸过之后，之后不管哪个线程
+        //acquire，节点内存都在池子构造时定好的节点上。
+        std::memset(block_.get(), 0, sizeof(Node) * capacity_);
+        freeList_.reserve(capacity_);
+        //整块内存先全部挂到空闲链表上，低地址的槽位放在栈顶，
+        //先被用到，保持访问的局部性。
+        for(size_t i = capacity_; i > 0; --i) {
+            freeList_.push_back(block_.get() + (i - 1) * sizeof(Node));
+        }
+    }
+
+    //池子管理裸内存，不允许拷贝。
+    NodePool(const NodePool&) = delete;
+    NodePool &operator=(const NodePool&) = delete;
+
+    //从池子里取一个槽位就地构造节点。
+    template<typename... Args>
+    Node *acquire(Args&&... args) {
+        void *slot = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(!freeList_.empty()) {
+                slot = freeList_.back();
+                freeList_.pop_back();
+            }
+        }
+        if(!slot) {
+            slot = ::operator new(sizeof(Node));
+        }
+        return new(slot) Node(std::forward<Args>(args)...);
+    }
+
+    //析构节点并回收槽位。
+    void release(Node *node) {
+        if(!node) return;
+        node->~Node();
+        auto *p = reinterpret_cast<unsigned char*>(node);
+        if(p >= block_.get() && p < block_.get() + sizeof(Node) * capacity_) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            freeList_.push_back(p);
+            return;
+        }
+        //堆上分配的后备节点直接还给堆。
+        ::operator delete(p);
+    }
+
+private:
+    size_t capacity_;
+    //一次性分配的连续内存块。
+    std::unique_ptr<unsigned char[]> block_;
+    //被回收的空闲槽位。
+    std::vector<void*> freeList_;
+    //保护空闲链表（见类注释：ARC共享池子时会从两把锁下并发进来）。
+    std::mutex mutex_;
+};
+
+} // namespace Cache
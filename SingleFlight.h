@@ -0,0 +1,204 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace Cache {
+
+/**
+ * singleflight：同一个key的并发加载合并成一次。
+ *
+ * 热点key未命中时，几百个线程会同时去后端捞同一份数据，后端被同一个
+ * 请求打穿。这里用一张“在途航班”表记录正在加载的key：第一个到的
+ * 线程当航班主，自己执行loader；后到的线程只拿到同一个
+ * shared_future，等航班主把结果公布出来。loader对一个key只执行一次，
+ * 结果也只插入缓存一次，loader抛的异常会原样传给所有等待者。
+ *
+ * 异步加载跑在自己持有的一个有界工作线程池上：线程按需创建、上限
+ * 之后排队，不同key的未命中风暴不会一口气spawn出无上界的线程。
+ * 停机时把排队的任务跑完、线程全部join，不会有加载线程活得比这个
+ * 对象久；进入停机之后的结果只通过future交付，不再写回缓存（缓存
+ * 正在销毁的路上）。
+ *
+ * 注意：这个对象住在 CachePolicy 基类里，具体缓存的成员（锁、索引、
+ * 内存池）在基类析构之前就已经拆掉了。所以每个具体引擎的析构函数
+ * 必须先调 shutdown() 再拆自己的状态，否则工作线程的写回会落在一个
+ * 拆了一半的缓存上。shutdown 可以重复调，析构兜底再调一次无害。
+ */
+template<typename Key, typename Value>
+class SingleFlight {
+public:
+    using Loader = std::function<Value(const Key &)>;
+    //拿到结果后把它放进缓存的回调（由调用方决定put到哪）。
+    using Inserter = std::function<void(const Key &, Value)>;
+
+    SingleFlight() = default;
+
+    ~SingleFlight() { shutdown(); }
+
+    //停机：不再往缓存写回，排队的任务照常跑完（等待者手里有
+    //future），然后join所有工作线程。幂等：线程表在锁下整个换
+    //出来，第二次调用拿到的是空表。
+    void shutdown() {
+        std::vector<std::thread> workers;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            workers.swap(workers_);
+        }
+        taskCv_.notify_all();
+        for(auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    //同步版：已有同key的航班就等它的结果；否则自己当航班主，在
+    //当前线程跑loader，结果先插入缓存再公布给所有等待者。
+    Value load(const Key &key, const Loader &loader, const Inserter &insert) {
+        std::promise<Value> promise;
+        std::shared_future<Value> flight;
+        bool owner = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = inflight_.find(key);
+            if(it != inflight_.end()) {
+                flight = it->second;
+            }
+            else {
+                flight = promise.get_future().share();
+                inflight_[key] = flight;
+                owner = true;
+            }
+        }
+        if(!owner) {
+            //搭别人的航班。锁在上面已经放掉了，等待不挡别的key。
+            return flight.get();
+        }
+
+        //和 runTask 一样先摘航班再公布结果，重试不会捞到旧航班。
+        try {
+            Value value = loader(key);
+            insert(key, value);
+            eraseFlight(key);
+            promise.set_value(std::move(value));
+        }
+        catch(...) {
+            eraseFlight(key);
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        return flight.get();
+    }
+
+    //异步版：返回future，调用方不在这儿停。没有在途航班时把加载
+    //任务排进工作线程池（回源通常是IO等待，池子线程专门干等这个），
+    //有的话直接把在途的future发回去。
+    std::shared_future<Value> loadAsync(const Key &key, Loader loader, Inserter insert) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = inflight_.find(key);
+        if(it != inflight_.end()) {
+            return it->second;
+        }
+
+        auto promise = std::make_shared<std::promise<Value>>();
+        std::shared_future<Value> flight = promise->get_future().share();
+        //先登记再起飞，保证别的线程不会漏看这个航班。
+        inflight_[key] = flight;
+        //停机之后没有工作线程可用了，任务在调用方线程上原地跑完
+        //（不写回缓存），future照常交付，不会有人等一个永远不落地
+        //的航班。
+        if(stopping_) {
+            FlightTask task{key, std::move(loader), std::move(insert), promise};
+            lock.unlock();
+            runTask(task);
+            return flight;
+        }
+        tasks_.push_back(FlightTask{key, std::move(loader), std::move(insert), promise});
+        //没有空闲线程、还没到上限时补一个工作线程。到了上限任务就
+        //排队，spawn出来的线程数永远有界。
+        if(idleWorkers_ == 0 && workers_.size() < kMaxLoaderThreads) {
+            workers_.emplace_back([this] { workerLoop(); });
+        }
+        taskCv_.notify_one();
+        return flight;
+    }
+
+private:
+    //一个排队的异步加载。
+    struct FlightTask {
+        Key key;
+        Loader loader;
+        Inserter insert;
+        std::shared_ptr<std::promise<Value>> promise;
+    };
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(true) {
+            ++idleWorkers_;
+            taskCv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            --idleWorkers_;
+            if(tasks_.empty()) return ;
+
+            FlightTask task = std::move(tasks_.front());
+            tasks_.pop_front();
+            lock.unlock();
+            runTask(task);
+            lock.lock();
+        }
+    }
+
+    //航班先从在途表摘掉、再公布结果：顺序反过来的话，等待者被结果
+    //唤醒后立刻重试，可能还能从表里捞到这趟已经结束的航班——失败
+    //的加载会让重试拿到同一份旧异常，而不是触发一次新的加载。
+    void runTask(FlightTask &task) {
+        try {
+            Value value = task.loader(task.key);
+            //停机阶段缓存已经在析构的路上，结果只通过future交付，
+            //不再往缓存里写。
+            if(!isStopping()) {
+                task.insert(task.key, value);
+            }
+            eraseFlight(task.key);
+            task.promise->set_value(std::move(value));
+        }
+        catch(...) {
+            eraseFlight(task.key);
+            task.promise->set_exception(std::current_exception());
+        }
+    }
+
+    bool isStopping() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stopping_;
+    }
+
+    void eraseFlight(const Key &key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inflight_.erase(key);
+    }
+
+private:
+    //异步加载线程数的上限。回源是IO等待，几条线程足够把延迟藏住；
+    //再多的未命中排队等空闲线程，不会放大后端压力。
+    static constexpr size_t kMaxLoaderThreads = 8;
+
+    std::mutex mutex_;
+    //key到在途航班的表，航班落地（公布结果）后就摘掉。
+    std::unordered_map<Key, std::shared_future<Value>> inflight_;
+    //排队的异步加载任务和跑它们的工作线程。
+    std::deque<FlightTask> tasks_;
+    std::vector<std::thread> workers_;
+    std::condition_variable taskCv_;
+    size_t idleWorkers_ = 0;
+    bool stopping_ = false;
+};
+
+}// namespace Cache
@@ -0,0 +1,356 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "CachePolicy.h"
+#include "CacheTtl.h"
+#include "NodePool.h"
+#include "CacheStatistics.h"
+#include "FlatHashMap.h"
+
+namespace Cache {
+
+template<typename Key, typename Value> class SlruCache;
+
+template<typename Key, typename Value>
+class SlruNode {
+public:
+    friend class SlruCache<Key, Value>;
+
+    SlruNode(Key key, Value value)
+        : key_(std::move(key))
+        , value_(std::move(value))
+        , inProtected_(false)
+        , prev_(nullptr)
+        , next_(nullptr)
+        , expireAt_(noExpire()) {}
+
+    Key getKey() const { return key_; }
+    //返回引用，由调用方决定拷还是不拷，省掉getter里的一次拷贝。
+    const Value &getValue() const { return value_; }
+    void setValue(const Value &value) { value_ = value; }
+    //右值直接move进来，不拷贝。
+    void setValue(Value &&value) { value_ = std::move(value); }
+    //TTL相关。没设TTL的节点存noExpire()哨兵，先比对哨兵再取当前
+    //时间，不带TTL的访问路径上没有时钟开销。
+    ExpireTime getExpireAt() const { return expireAt_; }
+    void setExpireAt(ExpireTime expireAt) { expireAt_ = expireAt; }
+    bool isExpired() const {
+        return expireAt_ != noExpire() && CacheClock::now() >= expireAt_;
+    }
+
+private:
+    Key key_;
+    Value value_;
+    //在protected段还是probation段。
+    bool inProtected_;
+    //侵入式双向链表的裸指针，节点的所有权在缓存手里（节点池）。
+    SlruNode<Key, Value> *prev_;
+    SlruNode<Key, Value> *next_;
+    //过期时间，noExpire()表示永不过期。
+    ExpireTime expireAt_;
+};
+
+/**
+ * 分段LRU（SLRU）：介于普通LRU和ARC之间的折中。普通LRU一轮扫描
+ * 就能把常驻热点全部冲掉；ARC扛得住扫描但身板重——两个部分、两个
+ * ghost、一次get最多摸四把锁。SLRU把一条LRU链拆成两段：新key一律
+ * 进probation段，在probation里再被命中一次才晋升进protected段，
+ * 淘汰永远先从probation下手。一次性扫描的key来了就走，死在probation
+ * 里，碰不到protected里的常驻热点；而结构上仍然是一把锁、一张索引、
+ * 每次操作一两次链表拼接，单次开销和普通LRU同一个量级。
+ *
+ * protected段占总容量的4/5（经典配比）。protected满了之后再晋升，
+ * 最老的protected条目会降回probation的热端，给它在被淘汰前再证明
+ * 一次自己的机会。
+ */
+template<typename Key, typename Value>
+class SlruCache : public CachePolicy<Key, Value> {
+public:
+    using NodeType = SlruNode<Key, Value>;
+    using NodePtr = NodeType*;
+    //key到节点的索引用扁平哈希表：槽位连续、按容量一次建好，
+    //稳态下没有rehash。两段共用这一张索引。
+    using NodeMap = FlatHashMap<Key, NodePtr>;
+
+    //节点池预留 capacity 个数据槽位，外加两对虚拟头尾。
+    explicit SlruCache(size_t capacity)
+            : capacity_(capacity)
+            , protectedCapacity_(capacity * 4 / 5)
+            , protectedSize_(0)
+            , nodePool_(capacity + 4)
+            , nodeMap_(capacity) {
+        probationHead_ = nodePool_.acquire(Key(), Value());
+        probationTail_ = nodePool_.acquire(Key(), Value());
+        probationHead_->next_ = probationTail_;
+        probationTail_->prev_ = probationHead_;
+        protectedHead_ = nodePool_.acquire(Key(), Value());
+        protectedTail_ = nodePool_.acquire(Key(), Value());
+        protectedHead_->next_ = protectedTail_;
+        protectedTail_->prev_ = protectedHead_;
+    }
+
+    //节点都是从池子里拿的裸指针，析构时逐个归还槽位。
+    ~SlruCache() override {
+        //singleflight的写回线程先join，再拆缓存自己的状态。
+        this->flight_.shutdown();
+        nodeMap_.forEach([this](const Key &, NodePtr node) {
+            nodePool_.release(node);
+        });
+        nodePool_.release(probationHead_);
+        nodePool_.release(probationTail_);
+        nodePool_.release(protectedHead_);
+        nodePool_.release(protectedTail_);
+    }
+
+    void put(Key key, Value value) override {
+        if(capacity_ <= 0) return ;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        reapStep();
+        putInternal(key, std::move(value));
+    }
+
+    //带TTL的写入：条目在ttl之后过期，过期后get当作未命中，内存由
+    //惰性检查和每次操作顺手做的增量清扫回收。
+    void putWithTtl(Key key, Value value, std::chrono::milliseconds ttl) {
+        if(capacity_ <= 0) return ;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        reapStep();
+        putInternal(key, std::move(value), CacheClock::now() + ttl);
+    }
+
+    bool get(Key key, Value &value) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reapStep();
+        return getInternal(key, value);
+    }
+
+    Value get(Key key) override {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    //异构查找版的get：string键可以直接拿string_view切片探测，命中
+    //路径和get完全一样（晋升、挪位置、记统计）。
+    template<typename K2>
+    bool get(const K2 &key, Value &value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reapStep();
+        return getInternal(key, value);
+    }
+
+    //只探测不访问：不晋升、不挪位置、不记统计。过期的条目当作
+    //不在，顺手回收。
+    template<typename K2>
+    bool contains(const K2 &key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        NodePtr *found = nodeMap_.find(key);
+        if(!found) return false;
+        if((*found)->isExpired()) {
+            eraseNode(*found);
+            stats_.recordEviction();
+            return false;
+        }
+        return true;
+    }
+
+    //读取/清零内置统计。
+    CacheStatsSnapshot getStats() const { return stats_.snapshot(); }
+    void resetStats() { stats_.reset(); }
+
+    //原地清空：两段的节点全部归还内存池，索引槽位数组原地重置。
+    void clear() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        nodeMap_.forEach([this](const Key &, NodePtr node) {
+            nodePool_.release(node);
+        });
+        nodeMap_.clear();
+        probationHead_->next_ = probationTail_;
+        probationTail_->prev_ = probationHead_;
+        protectedHead_->next_ = protectedTail_;
+        protectedTail_->prev_ = protectedHead_;
+        protectedSize_ = 0;
+        expiryQueue_.clear();
+    }
+
+    //删除单个key，不管它在哪一段。主动失效不记淘汰统计。
+    bool erase(Key key) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        NodePtr *found = nodeMap_.find(key);
+        if(!found) return false;
+        eraseNode(*found);
+        return true;
+    }
+
+    //批量预热：一次加锁灌进整个区间，迭代器指向pair<Key, Value>。
+    template<typename It>
+    void bulkLoad(It first, It last) {
+        if(capacity_ <= 0) return ;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(; first != last; ++first) {
+            putInternal(first->first, first->second);
+        }
+    }
+
+private:
+    //不加锁的内部实现。getInternal对查找键是模板的，异构版get直接
+    //复用同一条命中路径。
+    void putInternal(const Key &key, Value value, ExpireTime expireAt = noExpire()) {
+        stats_.recordPut();
+        NodePtr *found = nodeMap_.find(key);
+        if(found) {
+            NodePtr node = *found;
+            node->setValue(std::move(value));
+            //重新put会刷新过期时间（包括从有TTL改成没TTL）。
+            node->setExpireAt(expireAt);
+            //重复写也算一次访问，probation里的条目照样晋升。
+            promoteOnAccess(node);
+        }
+        else {
+            if(nodeMap_.size() >= capacity_) {
+                evictOne();
+            }
+            //新key一律从probation的热端进场，protected要靠第二次
+            //命中挣。
+            NodePtr newNode = nodePool_.acquire(key, std::move(value));
+            newNode->setExpireAt(expireAt);
+            insertBefore(newNode, probationTail_);
+            nodeMap_[key] = newNode;
+        }
+        if(expireAt != noExpire()) {
+            expiryQueue_.emplace_back(key, expireAt);
+        }
+    }
+
+    template<typename K2>
+    bool getInternal(const K2 &key, Value &value) {
+        NodePtr *found = nodeMap_.find(key);
+        if(found) {
+            NodePtr node = *found;
+            if(node->isExpired()) {
+                //过期的条目不算命中，顺手把它回收掉。
+                eraseNode(node);
+                stats_.recordEviction();
+                stats_.recordMiss();
+                return false;
+            }
+            promoteOnAccess(node);
+            value = node->getValue();
+            stats_.recordHit();
+            return true;
+        }
+        stats_.recordMiss();
+        return false;
+    }
+
+    /**
+     * 命中后的段间流转。protected里的命中就是普通的移到热端；
+     * probation里的命中是第二次访问（第一次是put进场），晋升进
+     * protected。protected装满时把它最冷的条目降回probation的热端
+     * ——不是直接淘汰，被顶下来的条目还有机会在probation里再挣
+     * 一次晋升，总条目数不变。
+     */
+    void promoteOnAccess(NodePtr node) {
+        if(node->inProtected_) {
+            removeNode(node);
+            insertBefore(node, protectedTail_);
+            return ;
+        }
+        removeNode(node);
+        insertBefore(node, protectedTail_);
+        node->inProtected_ = true;
+        ++protectedSize_;
+        if(protectedSize_ > protectedCapacity_) {
+            NodePtr demoted = protectedHead_->next_;
+            removeNode(demoted);
+            demoted->inProtected_ = false;
+            --protectedSize_;
+            insertBefore(demoted, probationTail_);
+        }
+    }
+
+    //淘汰永远先清probation的冷端；probation空了（全体都晋升了）
+    //才动protected的冷端。
+    void evictOne() {
+        NodePtr victim = probationHead_->next_;
+        if(victim == probationTail_) {
+            victim = protectedHead_->next_;
+            if(victim == protectedTail_) return ;
+        }
+        eraseNode(victim);
+        stats_.recordEviction();
+    }
+
+    //把一个节点从缓存里整个摘掉：哈希表、链表、节点池各清一处。
+    void eraseNode(NodePtr node) {
+        if(node->inProtected_) --protectedSize_;
+        nodeMap_.erase(node->getKey());
+        removeNode(node);
+        nodePool_.release(node);
+    }
+
+    void removeNode(NodePtr node) {
+        node->prev_->next_ = node->next_;
+        node->next_->prev_ = node->prev_;
+    }
+
+    void insertBefore(NodePtr node, NodePtr pos) {
+        node->next_ = pos;
+        node->prev_ = pos->prev_;
+        pos->prev_->next_ = node;
+        pos->prev_ = node;
+    }
+
+    //增量清扫过期条目，和 LruCache 同一套：FIFO队列记过期时间，
+    //每次操作从队头摘一小批到期的，重新put过的旧记录直接作废。
+    void reapStep() {
+        if(expiryQueue_.empty()) return ;
+
+        ExpireTime now = CacheClock::now();
+        int budget = kReapBatchSize;
+        while(budget-- > 0 && !expiryQueue_.empty()) {
+            const auto &record = expiryQueue_.front();
+            if(record.second > now) break;
+            NodePtr *found = nodeMap_.find(record.first);
+            if(found && (*found)->getExpireAt() == record.second) {
+                eraseNode(*found);
+                stats_.recordEviction();
+            }
+            expiryQueue_.pop_front();
+        }
+    }
+
+private:
+    size_t capacity_;
+    //protected段的容量上限（总容量的4/5）和当前长度。probation
+    //没有自己的上限，总数靠 capacity_ 限着。
+    size_t protectedCapacity_;
+    size_t protectedSize_;
+    std::mutex mutex_;
+    //节点内存池，两段的节点都从这里拿。
+    NodePool<NodeType> nodePool_;
+    //两段共用的key到节点索引。
+    NodeMap nodeMap_;
+    //probation段的虚拟头尾（表尾是热端）。
+    NodePtr probationHead_;
+    NodePtr probationTail_;
+    //protected段的虚拟头尾。
+    NodePtr protectedHead_;
+    NodePtr protectedTail_;
+    //命中/未命中/淘汰计数
+    CacheStatistics stats_;
+
+    //每次操作最多清扫多少条过期记录。
+    static const int kReapBatchSize = 8;
+    //带TTL的写入按插入顺序记在这条FIFO队列里，增量清扫从队头摘。
+    std::deque<std::pair<Key, ExpireTime>> expiryQueue_;
+};
+
+}// namespace Cache
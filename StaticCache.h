@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Cache {
+
+/**
+ * 静态（去虚化）快路径：CachePolicy 的虚接口方便用一个指针接收不同
+ * 的缓存策略（比如 test.cpp 里那样放进数组轮着测），但代价是每次
+ * put/get 都要查一次虚表，编译器也没法内联。对于编译期就定死了用哪
+ * 种缓存的调用方，可以用这个包装器：
+ *
+ *     Cache::StaticCache<Cache::LruCache<int, std::string>> cache(1024);
+ *     cache.put(1, "a");
+ *
+ * 所有调用都通过“对象.类名::成员”的限定方式转发，绕过虚表直接静态
+ * 绑定到具体实现上，可以被完全内联。需要多态时拿 impl() 当
+ * CachePolicy 用即可，两条路互不影响。
+ */
+template<typename CacheImpl>
+class StaticCache {
+public:
+    //构造参数原样转发给具体的缓存实现。
+    template<typename... Args>
+    explicit StaticCache(Args&&... args)
+            : impl_(std::forward<Args>(args)...) {}
+
+    template<typename K, typename V>
+    void put(K &&key, V &&value) {
+        impl_.CacheImpl::put(std::forward<K>(key), std::forward<V>(value));
+    }
+
+    template<typename K, typename V>
+    bool get(K &&key, V &value) {
+        return impl_.CacheImpl::get(std::forward<K>(key), value);
+    }
+
+    template<typename K>
+    auto get(K &&key) {
+        return impl_.CacheImpl::get(std::forward<K>(key));
+    }
+
+    template<typename Items>
+    void putMany(const Items &items) {
+        impl_.CacheImpl::putMany(items);
+    }
+
+    template<typename Keys, typename Values, typename Found>
+    size_t getMany(const Keys &keys, Values &values, Found &found) {
+        return impl_.CacheImpl::getMany(keys, values, found);
+    }
+
+    //需要走多态接口（或者调用具体实现特有的方法）时，直接拿内部对象。
+    CacheImpl &impl() { return impl_; }
+    const CacheImpl &impl() const { return impl_; }
+
+private:
+    CacheImpl impl_;
+};
+
+} // namespace Cache
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/flatmap_test.dir/flatmap_test.cpp.o"
+  "CMakeFiles/flatmap_test.dir/flatmap_test.cpp.o.d"
+  "flatmap_test"
+  "flatmap_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/flatmap_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
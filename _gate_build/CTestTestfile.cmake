@@ -0,0 +1,10 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo
+# Build directory: /root/repo/_gate_build
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(flatmap_test "/root/repo/_gate_build/flatmap_test")
+set_tests_properties(flatmap_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;21;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(cache_test "/root/repo/_gate_build/cache_test")
+set_tests_properties(cache_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;26;add_test;/root/repo/CMakeLists.txt;0;")
@@ -0,0 +1,343 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "LruCache.h"
+#include "LfuCache.h"
+#include "ClockLruCache.h"
+#include "ArcCache/ArcCache.h"
+
+/**
+ * 多线程吞吐/延迟基准：test.cpp 关注的是命中率，这里关注的是多个
+ * 线程同时打一个缓存时每秒能做多少次操作、单次操作的延迟分布。
+ *
+ * 用法：
+ *   ./benchmark [线程数] [每线程操作数]        合成负载
+ *   ./benchmark --trace <文件> [线程数]        回放生产trace
+ *
+ * trace 是文本文件，一行一个操作：
+ *   G <key>    读
+ *   P <key>    写
+ * 只有一个数字的行当作读。文件通过 mmap 映射进来原地解析，几个GB
+ * 的 trace 也不用先读进内存，各线程按行边界分段并行回放。
+ */
+
+//每个线程采样记录的延迟条数上限（每隔若干次操作采一次样，
+//避免记录本身影响测试结果）。
+static const int kLatencySampleInterval = 16;
+
+struct BenchResult {
+    //总耗时（秒）
+    double seconds;
+    //总操作数
+    uint64_t operations;
+    //命中数与读操作数
+    uint64_t hits;
+    uint64_t gets;
+    //采样到的单次操作延迟（纳秒），已排序
+    std::vector<uint64_t> latencies;
+};
+
+//取排序后延迟数组的分位数
+static uint64_t percentile(const std::vector<uint64_t> &sorted, double p) {
+    if(sorted.empty()) return 0;
+    size_t idx = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[idx];
+}
+
+/**
+ * 多个线程对同一个缓存做混合读写（70%读，30%写）。访问模式和
+ * test.cpp 的热点场景一致：40%的操作落在少量热点key上，其余落在
+ * 大范围的冷key上。
+ */
+static BenchResult runMixedWorkload(Cache::CachePolicy<int, std::string> &cache,
+                                    int threadNum, int opsPerThread) {
+    const int HOT_KEYS = 100;
+    const int COLD_KEYS = 100000;
+
+    std::atomic<uint64_t> totalHits{0};
+    std::atomic<uint64_t> totalGets{0};
+    std::vector<std::vector<uint64_t>> threadLatencies(threadNum);
+
+    //先预热，把热点数据放进去。
+    for(int key = 0; key < HOT_KEYS; ++key) {
+        cache.put(key, "warm" + std::to_string(key));
+    }
+
+    auto worker = [&](int tid) {
+        std::mt19937 gen(1234 + tid);
+        std::vector<uint64_t> &latencies = threadLatencies[tid];
+        latencies.reserve(opsPerThread / kLatencySampleInterval + 1);
+        uint64_t hits = 0, gets = 0;
+
+        for(int op = 0; op < opsPerThread; ++op) {
+            int key;
+            if(op % 100 < 40) {
+                key = gen() % HOT_KEYS;
+            }
+            else {
+                key = HOT_KEYS + (gen() % COLD_KEYS);
+            }
+
+            bool sample = (op % kLatencySampleInterval == 0);
+            auto start = sample ? std::chrono::steady_clock::now()
+                                : std::chrono::steady_clock::time_point();
+
+            if(op % 100 < 70) {
+                //70%读
+                std::string value;
+                ++gets;
+                if(cache.get(key, value)) ++hits;
+            }
+            else {
+                //30%写
+                cache.put(key, "value" + std::to_string(key));
+            }
+
+            if(sample) {
+                auto end = std::chrono::steady_clock::now();
+                latencies.push_back(std::chrono::duration_cast<
+                        std::chrono::nanoseconds>(end - start).count());
+            }
+        }
+        totalHits += hits;
+        totalGets += gets;
+    };
+
+    auto benchStart = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(int t = 0; t < threadNum; ++t) {
+        threads.emplace_back(worker, t);
+    }
+    for(auto &t : threads) {
+        t.join();
+    }
+    auto benchEnd = std::chrono::steady_clock::now();
+
+    BenchResult result;
+    result.seconds = std::chrono::duration<double>(benchEnd - benchStart).count();
+    result.operations = static_cast<uint64_t>(threadNum) * opsPerThread;
+    result.hits = totalHits.load();
+    result.gets = totalGets.load();
+    for(auto &latencies : threadLatencies) {
+        result.latencies.insert(result.latencies.end(),
+                                latencies.begin(), latencies.end());
+    }
+    std::sort(result.latencies.begin(), result.latencies.end());
+    return result;
+}
+
+//====================trace回放====================
+
+//mmap 打开的只读trace文件，析构时自动解除映射。
+struct MappedTrace {
+    const char *data = nullptr;
+    size_t size = 0;
+    int fd = -1;
+
+    bool open(const char *path) {
+        fd = ::open(path, O_RDONLY);
+        if(fd < 0) return false;
+        struct stat st;
+        if(fstat(fd, &st) < 0 || st.st_size == 0) return false;
+        size = static_cast<size_t>(st.st_size);
+        void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p == MAP_FAILED) return false;
+        //顺序回放，提示内核做顺序预读。
+        madvise(p, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(p);
+        return true;
+    }
+
+    ~MappedTrace() {
+        if(data) munmap(const_cast<char*>(data), size);
+        if(fd >= 0) ::close(fd);
+    }
+};
+
+/**
+ * 回放 trace 的 [begin, end) 字节区间，begin/end 已经对齐到行边界。
+ * 原地解析，不产生任何字符串分配。
+ */
+static void replayRange(Cache::CachePolicy<int, std::string> &cache,
+                        const char *begin, const char *end,
+                        uint64_t &hits, uint64_t &gets, uint64_t &ops) {
+    const char *p = begin;
+    while(p < end) {
+        //行首的操作类型（没有就当作读）
+        bool isPut = false;
+        if(*p == 'P' || *p == 'p') isPut = true;
+        while(p < end && (*p < '0' || *p > '9') && *p != '\n') ++p;
+        //解析key
+        int key = 0;
+        bool hasKey = false;
+        while(p < end && *p >= '0' && *p <= '9') {
+            key = key * 10 + (*p - '0');
+            ++p;
+            hasKey = true;
+        }
+        //跳到下一行
+        while(p < end && *p != '\n') ++p;
+        if(p < end) ++p;
+        if(!hasKey) continue;
+
+        ++ops;
+        if(isPut) {
+            cache.put(key, "value");
+        }
+        else {
+            std::string value;
+            ++gets;
+            if(cache.get(key, value)) ++hits;
+        }
+    }
+}
+
+static BenchResult runTraceReplay(Cache::CachePolicy<int, std::string> &cache,
+                                  const MappedTrace &trace, int threadNum) {
+    std::atomic<uint64_t> totalHits{0};
+    std::atomic<uint64_t> totalGets{0};
+    std::atomic<uint64_t> totalOps{0};
+
+    //按字节均分再对齐到行边界，每个线程回放自己的一段。
+    std::vector<const char*> bounds(threadNum + 1);
+    bounds[0] = trace.data;
+    bounds[threadNum] = trace.data + trace.size;
+    for(int t = 1; t < threadNum; ++t) {
+        const char *p = trace.data + trace.size * t / threadNum;
+        while(p < trace.data + trace.size && *p != '\n') ++p;
+        if(p < trace.data + trace.size) ++p;
+        bounds[t] = p;
+    }
+
+    auto benchStart = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(int t = 0; t < threadNum; ++t) {
+        threads.emplace_back([&, t] {
+            uint64_t hits = 0, gets = 0, ops = 0;
+            replayRange(cache, bounds[t], bounds[t + 1], hits, gets, ops);
+            totalHits += hits;
+            totalGets += gets;
+            totalOps += ops;
+        });
+    }
+    for(auto &t : threads) {
+        t.join();
+    }
+    auto benchEnd = std::chrono::steady_clock::now();
+
+    BenchResult result;
+    result.seconds = std::chrono::duration<double>(benchEnd - benchStart).count();
+    result.hits = totalHits.load();
+    result.gets = totalGets.load();
+    result.operations = totalOps.load();
+    return result;
+}
+
+static void printResult(const std::string &name, const BenchResult &r) {
+    std::cout << std::left << std::setw(10) << name
+              << " 吞吐: " << std::fixed << std::setprecision(2) << std::setw(10)
+              << (r.operations / r.seconds / 1e6) << " Mops/s"
+              << "  命中率: " << std::setprecision(2)
+              << (r.gets ? 100.0 * r.hits / r.gets : 0.0) << "%";
+    if(!r.latencies.empty()) {
+        std::cout << "  延迟p50: " << percentile(r.latencies, 0.50) << "ns"
+                  << "  p99: " << percentile(r.latencies, 0.99) << "ns"
+                  << "  p999: " << percentile(r.latencies, 0.999) << "ns";
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int threadNum = std::max(2u, std::thread::hardware_concurrency());
+    int opsPerThread = 200000;
+
+    const int CAPACITY = 10000;
+
+    if(argc > 2 && std::string(argv[1]) == "--trace") {
+        MappedTrace trace;
+        if(!trace.open(argv[2])) {
+            std::cerr << "无法打开trace文件: " << argv[2] << std::endl;
+            return 1;
+        }
+        if(argc > 3) threadNum = std::stoi(argv[3]);
+
+        std::cout << "=== trace回放基准 ===" << std::endl;
+        std::cout << "文件: " << argv[2] << " (" << trace.size << " 字节)"
+                  << "  线程数: " << threadNum
+                  << "  缓存容量: " << CAPACITY << std::endl;
+
+        {
+            Cache::LruCache<int, std::string> lru(CAPACITY);
+            printResult("LRU", runTraceReplay(lru, trace, threadNum));
+        }
+        {
+            Cache::HashLruCaches<int, std::string> hashLru(CAPACITY);
+            printResult("HASHLRU", runTraceReplay(hashLru, trace, threadNum));
+        }
+        {
+            Cache::LfuCache<int, std::string> lfu(CAPACITY);
+            printResult("LFU", runTraceReplay(lfu, trace, threadNum));
+        }
+        {
+            Cache::HashLfuCaches<int, std::string> hashLfu(CAPACITY);
+            printResult("HASHLFU", runTraceReplay(hashLfu, trace, threadNum));
+        }
+        {
+            Cache::ArcCache<int, std::string> arc(CAPACITY);
+            printResult("ARC", runTraceReplay(arc, trace, threadNum));
+        }
+        {
+            Cache::ClockLruCache<int, std::string> clock(CAPACITY);
+            printResult("CLOCK", runTraceReplay(clock, trace, threadNum));
+        }
+        return 0;
+    }
+
+    if(argc > 1) threadNum = std::stoi(argv[1]);
+    if(argc > 2) opsPerThread = std::stoi(argv[2]);
+
+    std::cout << "=== 多线程混合读写基准 ===" << std::endl;
+    std::cout << "线程数: " << threadNum
+              << "  每线程操作数: " << opsPerThread
+              << "  缓存容量: " << CAPACITY << std::endl;
+
+    {
+        Cache::LruCache<int, std::string> lru(CAPACITY);
+        printResult("LRU", runMixedWorkload(lru, threadNum, opsPerThread));
+    }
+    {
+        Cache::HashLruCaches<int, std::string> hashLru(CAPACITY);
+        printResult("HASHLRU", runMixedWorkload(hashLru, threadNum, opsPerThread));
+    }
+    {
+        Cache::LfuCache<int, std::string> lfu(CAPACITY);
+        printResult("LFU", runMixedWorkload(lfu, threadNum, opsPerThread));
+    }
+    {
+        Cache::HashLfuCaches<int, std::string> hashLfu(CAPACITY);
+        printResult("HASHLFU", runMixedWorkload(hashLfu, threadNum, opsPerThread));
+    }
+    {
+        Cache::ArcCache<int, std::string> arc(CAPACITY);
+        printResult("ARC", runMixedWorkload(arc, threadNum, opsPerThread));
+    }
+    {
+        Cache::ClockLruCache<int, std::string> clock(CAPACITY);
+        printResult("CLOCK", runMixedWorkload(clock, threadNum, opsPerThread));
+    }
+
+    return 0;
+}
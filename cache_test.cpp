@@ -0,0 +1,220 @@
+#include "LruCache.h"
+#include "LfuCache.h"
+#include "SlruCache.h"
+#include "ClockLruCache.h"
+#include "FlatLruCache.h"
+#include "ArcCache/ArcCache.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Cache;
+using namespace std::chrono_literals;
+
+//各个引擎共用的基本行为检查：写入、命中、erase的真假返回、clear
+//之后全部未命中、清空后还能正常复用。
+template<typename C>
+static void exercise(C &c, const char *name) {
+    for(int i = 0; i < 20; ++i) c.put(i, i);
+    int v;
+    c.get(3, v);
+    assert(c.erase(3));
+    assert(!c.erase(3));
+    assert(!c.get(3, v));
+    c.clear();
+    for(int i = 0; i < 20; ++i) assert(!c.get(i, v));
+    c.put(7, 70);
+    assert(c.get(7, v) && v == 70);
+    printf("%s ok\n", name);
+}
+
+//每个引擎都过一遍clear/erase，包括分片包装器。
+static void testClearErase() {
+    { LruCache<int, int> c(32); exercise(c, "lru"); }
+    { LruKCache<int, int> c(32, 64, 2); c.put(1, 1); c.put(1, 1); exercise(c, "lruk"); }
+    { HashLruCaches<int, int> c(64, 4); exercise(c, "hashlru"); }
+    { LfuCache<int, int> c(32); exercise(c, "lfu"); }
+    { HashLfuCaches<int, int> c(64, 4); exercise(c, "hashlfu"); }
+    { SlruCache<int, int> c(32); exercise(c, "slru"); }
+    { ClockLruCache<int, int> c(32); exercise(c, "clock"); }
+    { ArcCache<int, int> c(32); exercise(c, "arc"); }
+    { FlatLruCache<int, int> c(32); exercise(c, "flatlru"); }
+
+    //clear不应触发淘汰回调（条目是调用方主动扔的，不是被顶出去的），
+    //之后容量淘汰照常触发。
+    {
+        LruCache<int, std::string> c(8);
+        int fired = 0;
+        c.setEvictionCallback([&](int, std::string) { ++fired; });
+        for(int i = 0; i < 8; ++i) c.put(i, "v");
+        c.erase(2);
+        c.clear();
+        assert(fired == 0);
+        for(int i = 0; i < 12; ++i) c.put(100 + i, "w");
+        assert(fired == 4);
+    }
+
+    //bulkLoad预热后全部可读。
+    {
+        std::vector<std::pair<int, int>> items;
+        for(int i = 0; i < 100; ++i) items.emplace_back(i, i * 2);
+        LruCache<int, int> a(128);
+        a.bulkLoad(items.begin(), items.end());
+        LfuCache<int, int> b(128);
+        b.bulkLoad(items.begin(), items.end());
+        HashLruCaches<int, int> h(256, 4);
+        h.bulkLoad(items.begin(), items.end());
+        int v;
+        for(int i = 0; i < 100; ++i) {
+            assert(a.get(i, v) && v == i * 2);
+            assert(b.get(i, v) && v == i * 2);
+            assert(h.get(i, v) && v == i * 2);
+        }
+    }
+    puts("clear/erase ok");
+}
+
+//TTL：过期条目按未命中处理，重新put刷新过期时间，没有TTL的条目
+//不受影响。
+static void testTtl() {
+    std::string v;
+    LruCache<int, std::string> lru(10);
+    lru.putWithTtl(1, "a", 50ms);
+    lru.put(2, "b");
+    assert(lru.get(1, v) && v == "a");
+    std::this_thread::sleep_for(80ms);
+    assert(!lru.get(1, v));
+    assert(lru.get(2, v) && v == "b");
+    lru.putWithTtl(3, "c", 50ms);
+    lru.putWithTtl(3, "c2", 10min);
+    std::this_thread::sleep_for(80ms);
+    assert(lru.get(3, v) && v == "c2");
+
+    LfuCache<int, std::string> lfu(10);
+    lfu.putWithTtl(1, "a", 50ms);
+    assert(lfu.get(1, v) && v == "a");
+    std::this_thread::sleep_for(80ms);
+    assert(!lfu.get(1, v));
+
+    ArcCache<int, std::string> arc(10);
+    arc.putWithTtl(1, "a", 50ms);
+    assert(arc.get(1, v) && v == "a");
+    std::this_thread::sleep_for(80ms);
+    assert(!arc.get(1, v));
+    puts("ttl ok");
+}
+
+//快照/恢复：条目回来，各引擎自己的“热度”也要回来——LRU的访问序、
+//LFU的频率、分片包装器换分片数也能恢复。
+static void testSnapshot() {
+    std::string v;
+    {
+        LruCache<int, std::string> c(100);
+        for(int i = 0; i < 150; ++i) c.put(i, "v" + std::to_string(i));
+        c.get(60);
+        c.get(61);
+        assert(c.snapshot("/tmp/cache_test_lru.snap"));
+        LruCache<int, std::string> r(100);
+        assert(r.restore("/tmp/cache_test_lru.snap"));
+        assert(r.get(60, v) && v == "v60");
+        assert(!r.get(10, v));
+        //灌98个新key把冷的顶掉，热的60/61必须还在。
+        for(int i = 1000; i < 1098; ++i) r.put(i, "x");
+        assert(r.get(60, v) && r.get(61, v));
+    }
+    {
+        LfuCache<int, std::string> c(50);
+        for(int i = 0; i < 50; ++i) c.put(i, "v" + std::to_string(i));
+        for(int j = 0; j < 10; ++j) c.get(7);
+        assert(c.snapshot("/tmp/cache_test_lfu.snap"));
+        LfuCache<int, std::string> r(50);
+        assert(r.restore("/tmp/cache_test_lfu.snap"));
+        for(int i = 2000; i < 2049; ++i) r.put(i, "x");
+        assert(r.get(7, v) && v == "v7");
+    }
+    {
+        HashLruCaches<int, std::string> c(400, 4);
+        for(int i = 0; i < 300; ++i) c.put(i, "s" + std::to_string(i));
+        assert(c.snapshot("/tmp/cache_test_hlru.snap"));
+        //换一个分片数恢复也要能读回绝大多数条目。
+        HashLruCaches<int, std::string> r(400, 8);
+        assert(r.restore("/tmp/cache_test_hlru.snap"));
+        int hits = 0;
+        for(int i = 0; i < 300; ++i) {
+            if(r.get(i, v)) ++hits;
+        }
+        assert(hits >= 290);
+    }
+    puts("snapshot ok");
+}
+
+//淘汰回调：容量淘汰和TTL过期都要带着key和value交付，且在锁外。
+static void testEvictionCallback() {
+    {
+        std::set<int> evictedKeys;
+        LruCache<int, std::string> c(5);
+        c.setEvictionCallback([&](int k, std::string val) {
+            evictedKeys.insert(k);
+            assert(val == "v" + std::to_string(k));
+        });
+        for(int i = 0; i < 12; ++i) c.put(i, "v" + std::to_string(i));
+        assert(evictedKeys.size() == 7);
+        assert(evictedKeys.count(0) && !evictedKeys.count(7));
+    }
+    {
+        int fired = 0;
+        LruCache<int, std::string> c(10);
+        c.setEvictionCallback([&](int, std::string) { ++fired; });
+        c.putWithTtl(1, "x", 5ms);
+        std::this_thread::sleep_for(20ms);
+        std::string v;
+        c.get(1, v);
+        assert(fired == 1);
+    }
+    //LFU交付的牺牲者必须是频率最低的那个。
+    {
+        std::set<int> evictedKeys;
+        LfuCache<int, std::string> c(3);
+        c.setEvictionCallback([&](int k, std::string) { evictedKeys.insert(k); });
+        c.put(1, "a");
+        c.put(2, "b");
+        c.put(3, "c");
+        std::string v;
+        c.get(1, v);
+        c.get(2, v);
+        c.put(4, "d");
+        assert(evictedKeys.count(3) && evictedKeys.size() == 1);
+    }
+    //回调在锁外交付：回调里写另一个缓存不能死锁。
+    {
+        LruCache<int, int> backing(100);
+        LruCache<int, int> c(2);
+        c.setEvictionCallback([&](int k, int val) { backing.put(k, val); });
+        for(int i = 0; i < 10; ++i) c.put(i, i * 2);
+        int v = 0;
+        assert(backing.get(3, v) && v == 6);
+    }
+    //分片包装器把回调转发给每个分片。
+    {
+        int fired = 0;
+        HashLruCaches<int, int> c(8, 4);
+        c.setEvictionCallback([&](int, int) { ++fired; });
+        for(int i = 0; i < 100; ++i) c.put(i, i);
+        assert(fired > 0);
+    }
+    puts("eviction callback ok");
+}
+
+int main() {
+    testClearErase();
+    testTtl();
+    testSnapshot();
+    testEvictionCallback();
+    puts("cache test passed");
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "FlatHashMap.h"
+
+#include <cassert>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+//FlatHashMap 的对拍测试：对同一串随机操作流，扁平表的行为必须和
+//std::unordered_map 完全一致。200万次混合的插入/删除/查找在一个
+//比容量略大的键域上反复搅动，robin-hood 的让位和删除的后移补洞
+//在高删除率下最容易出错，这里专门压这条路径。
+static void churnAgainstReference() {
+    Cache::FlatHashMap<int, int> fm(500);
+    std::unordered_map<int, int> ref;
+    std::mt19937 rng(42);
+
+    for(int i = 0; i < 2000000; ++i) {
+        int key = rng() % 700;
+        int op = rng() % 3;
+        if(op == 0) {
+            fm[key] = i;
+            ref[key] = i;
+        }
+        else if(op == 1) {
+            //删除的返回值也要一致。
+            assert(fm.erase(key) == (ref.erase(key) > 0));
+        }
+        else {
+            int *p = fm.find(key);
+            auto it = ref.find(key);
+            assert((p != nullptr) == (it != ref.end()));
+            if(p) assert(*p == it->second);
+        }
+        assert(fm.size() == ref.size());
+    }
+
+    //遍历到的条目和参照表一一对应，槽位游标数出来的也一样多。
+    size_t n = 0;
+    fm.forEach([&](const int &k, int v) {
+        assert(ref.at(k) == v);
+        ++n;
+    });
+    assert(n == ref.size());
+    size_t m = 0;
+    for(size_t i = 0; i < fm.slotCount(); ++i) {
+        if(fm.occupiedAt(i)) ++m;
+    }
+    assert(m == ref.size());
+    printf("churn ok, final size=%zu\n", n);
+}
+
+//带预算hash的 find/findOrInsert 必须和自己算hash的版本等价：
+//分片缓存把选分片时算的hash传下来，两条路径指向同一个条目。
+static void precomputedHashMatchesDefault() {
+    Cache::TransparentHash hasher;
+    Cache::FlatHashMap<std::string, int> fm(64);
+    for(int i = 0; i < 100; ++i) {
+        std::string key = "key-" + std::to_string(i);
+        fm.findOrInsert(key, hasher(key)) = i;
+    }
+    for(int i = 0; i < 100; ++i) {
+        std::string key = "key-" + std::to_string(i);
+        int *a = fm.find(key);
+        int *b = fm.find(key, hasher(key));
+        assert(a && a == b && *a == i);
+        //异构查找键配异构算的hash也要落在同一个条目上。
+        std::string_view sv(key);
+        int *c = fm.find(sv, hasher(sv));
+        assert(c == a);
+    }
+    //已存在的key走 findOrInsert 不能插出第二个条目。
+    size_t before = fm.size();
+    std::string key = "key-7";
+    fm.findOrInsert(key, hasher(key)) = 700;
+    assert(fm.size() == before);
+    assert(*fm.find(key) == 700);
+    printf("precomputed hash ok\n");
+}
+
+int main() {
+    churnAgainstReference();
+    precomputedHashMatchesDefault();
+    printf("flatmap test passed\n");
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "LruCache.h"
+#include "LfuCache.h"
+#include "ArcCache/ArcCache.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Cache;
+
+//同步版：同一个key的并发未命中合并成一次loader执行。
+static void testDedup() {
+    std::atomic<int> loaderCalls{0};
+    LruCache<int, std::string> c(32);
+    std::vector<std::thread> ts;
+    for(int t = 0; t < 8; ++t) {
+        ts.emplace_back([&c, &loaderCalls] {
+            std::string v = c.getOrLoad(7, [&loaderCalls](const int &) {
+                ++loaderCalls;
+                std::this_thread::sleep_for(std::chrono::milliseconds(30));
+                return std::string("seven");
+            });
+            assert(v == "seven");
+        });
+    }
+    for(auto &th : ts) th.join();
+    assert(loaderCalls.load() == 1);
+    puts("dedup ok");
+}
+
+//异步版：结果通过future交付，loader线程顺手写回缓存。
+static void testAsyncInsert() {
+    LruCache<int, std::string> c(32);
+    auto f = c.getOrLoadAsync(1, [](const int &) { return std::string("one"); });
+    assert(f.get() == "one");
+    //写回在工作线程上，future就绪后可能还要等一拍。
+    std::string v;
+    for(int i = 0; i < 100 && !c.get(1, v); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(v == "one");
+    puts("async insert ok");
+}
+
+//500个不同key的未命中风暴：所有future都要落地，线程数在内部有界
+//（上限没法从外面直接观察，这里压的是不崩、不耗尽）。
+static void testMissStorm() {
+    LruCache<int, int> c(2048);
+    std::vector<std::shared_future<int>> fs;
+    for(int i = 0; i < 500; ++i) {
+        fs.push_back(c.getOrLoadAsync(i, [](const int &k) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            return k * 2;
+        }));
+    }
+    for(int i = 0; i < 500; ++i) assert(fs[i].get() == i * 2);
+    puts("miss storm ok");
+}
+
+//加载还在途时销毁缓存：析构必须先join掉加载线程再拆自己的状态，
+//future照常落地，不能有写回落在拆了一半的缓存上（在ASan/TSan下
+//跑这一段才有完整的说服力）。对几种引擎都来一遍——singleflight
+//住在基类里，销毁顺序的坑对每个派生引擎都存在。
+static void testDestroyMidFlight() {
+    {
+        std::shared_future<int> f;
+        {
+            LruCache<int, int> c(16);
+            f = c.getOrLoadAsync(42, [](const int &k) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                return k;
+            });
+        }//loader还在睡，缓存在这里析构
+        assert(f.get() == 42);
+    }
+    {
+        std::vector<std::shared_future<int>> fs;
+        {
+            LfuCache<int, int> c(64);
+            for(int i = 0; i < 32; ++i) {
+                fs.push_back(c.getOrLoadAsync(i, [](const int &k) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                    return k + 100;
+                }));
+            }
+        }
+        for(int i = 0; i < 32; ++i) assert(fs[i].get() == i + 100);
+    }
+    {
+        std::shared_future<int> f;
+        {
+            ArcCache<int, int> c(16);
+            f = c.getOrLoadAsync(9, [](const int &k) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                return k * 3;
+            });
+        }
+        assert(f.get() == 27);
+    }
+    puts("destroy mid-flight ok");
+}
+
+//loader抛异常：所有等待者拿到同一份异常，航班从在途表摘掉，
+//紧接着的重试触发一次新的加载而不是捞到旧异常。
+static void testException() {
+    LruCache<int, int> c(16);
+    auto f = c.getOrLoadAsync(5, [](const int &) -> int {
+        throw std::runtime_error("boom");
+    });
+    bool threw = false;
+    try {
+        f.get();
+    }
+    catch(const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+    auto retry = c.getOrLoadAsync(5, [](const int &k) { return k + 1; });
+    assert(retry.get() == 6);
+    puts("exception ok");
+}
+
+int main() {
+    testDedup();
+    testAsyncInsert();
+    testMissStorm();
+    testDestroyMidFlight();
+    testException();
+    puts("singleflight test passed");
+    return 0;
+}
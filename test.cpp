@@ -5,10 +5,12 @@
 #include <iomanip>
 #include <random>
 #include <algorithm>
+#include <array>
 
 #include "LruCache.h"
 #include "LfuCache.h"
 #include "ArcCache/ArcCache.h"
+#include "SlruCache.h"
 
 void printResults(const std::string &testName, int capacity, 
                     const std::vector<int> &get_operations, 
@@ -26,6 +28,8 @@ void printResults(const std::string &testName, int capacity,
               << (100.0 * hits[3] / get_operations[3]) << "%" << std::endl;
     std::cout << "ARC - 命中率: " << std::fixed << std::setprecision(2)
               << (100.0 * hits[4] / get_operations[4]) << "%" << std::endl;
+    std::cout << "SLRU - 命中率: " << std::fixed << std::setprecision(2)
+              << (100.0 * hits[5] / get_operations[5]) << "%" << std::endl;
 }
 
 void testHotDataAccess() {
@@ -47,6 +51,7 @@ void testHotDataAccess() {
     Cache::LfuCache<int, std::string> lfu(CAPACITY);
     Cache::HashLfuCaches<int, std::string> hashLfu(CAPACITY);
     Cache::ArcCache<int, std::string> arc(CAPACITY); 
+    Cache::SlruCache<int, std::string> slru(CAPACITY);
 
     //它提供了一个非确定性的随机数生成器。 与伪随机数
     //生成器不同，它不依赖于种子，因此每次生成的随机
@@ -58,10 +63,10 @@ void testHotDataAccess() {
     std::mt19937 gen(rd());   
 
     //3个类型为 CachePolicy<int, std::string>* 的数据
-    std::array<Cache::CachePolicy<int, std::string>*, 5> caches = {&lru, &hashLru, &lfu, &hashLfu, &arc};
+    std::array<Cache::CachePolicy<int, std::string>*, 6> caches = {&lru, &hashLru, &lfu, &hashLfu, &arc, &slru};
     //hits被初始化为3个为0的数据
-    std::vector<int> hits(5, 0);
-    std::vector<int> get_operations(5, 0);
+    std::vector<int> hits(6, 0);
+    std::vector<int> get_operations(6, 0);
 
     for(size_t i = 0; i < caches.size(); ++i) {
         for(int op = 0; op < OPERATIONS; ++op) {
@@ -114,10 +119,11 @@ void testLoopPattern() {
     Cache::LfuCache<int, std::string> lfu(CAPACITY);
     Cache::HashLfuCaches<int, std::string> hashLfu(CAPACITY);
     Cache::ArcCache<int, std::string> arc(CAPACITY);
+    Cache::SlruCache<int, std::string> slru(CAPACITY);
 
-    std::array<Cache::CachePolicy<int, std::string>*, 5> caches = {&lru, &hashLru, &lfu, &hashLfu, &arc};
-    std::vector<int> hits(5, 0);
-    std::vector<int> get_operations(5, 0);
+    std::array<Cache::CachePolicy<int, std::string>*, 6> caches = {&lru, &hashLru, &lfu, &hashLfu, &arc, &slru};
+    std::vector<int> hits(6, 0);
+    std::vector<int> get_operations(6, 0);
 
     std::random_device rd;
     std::mt19937 gen(rd());
@@ -165,12 +171,13 @@ void testWorkLoadShift() {
     Cache::LfuCache<int, std::string> lfu(CAPACITY);
     Cache::HashLfuCaches<int, std::string> hashLfu(CAPACITY);
     Cache::ArcCache<int, std::string> arc(CAPACITY);
+    Cache::SlruCache<int, std::string> slru(CAPACITY);
 
     std::random_device rd;
     std::mt19937 gen(rd());
-    std::array<Cache::CachePolicy<int, std::string>*, 5> caches = {&lru, &hashLru, &lfu, &hashLfu, &arc};
-    std::vector<int> hits(5, 0);
-    std::vector<int> get_operations(5, 0);
+    std::array<Cache::CachePolicy<int, std::string>*, 6> caches = {&lru, &hashLru, &lfu, &hashLfu, &arc, &slru};
+    std::vector<int> hits(6, 0);
+    std::vector<int> get_operations(6, 0);
 
     // 先填充一些初始数据
     for (size_t i = 0; i < caches.size(); ++i) {